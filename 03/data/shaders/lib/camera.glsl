@@ -0,0 +1,92 @@
+// primary rays, define CAMERA_MIRRORED before the include to mirror the
+// left half of the screen
+
+#include "common.glsl"
+
+// direction of the ray through screen position p in [0, 1]^2 of a camera
+// with the given basis
+vec3 camera_ray(vec2 p, mat4 basis) {
+  vec2 uv = p * 2.0 - vec2(1.0, 1.0);
+  uv.x *= resolution.x / resolution.y; // aspect ratio
+#ifdef CAMERA_MIRRORED
+  uv.x = abs(uv.x);
+#endif
+  return mat3(basis) * vec3(uv, 1.0);
+}
+
+// Screen position where the previous camera saw x, outside of [0, 1]^2
+// when it could not.
+vec2 previous_screen(vec3 x) {
+  vec3 v = x - previous_camera[3].xyz;
+  mat3 basis = mat3(previous_camera);
+  float depth = dot(v, basis[2]) / dot(basis[2], basis[2]);
+  if (depth <= 0.0) {
+    return vec2(-1.0);
+  }
+
+  vec2 uv = vec2(
+    dot(v, basis[0]) / dot(basis[0], basis[0]),
+    dot(v, basis[1]) / dot(basis[1], basis[1])) / depth;
+  uv.x /= resolution.x / resolution.y;
+#ifdef CAMERA_MIRRORED
+  // only the right half of the directions is on screen
+  if (uv.x < 0.0) {
+    return vec2(-1.0);
+  }
+#endif
+  return (uv + vec2(1.0, 1.0)) * 0.5;
+}
+
+bool on_screen(vec2 q) {
+  return all(greaterThanEqual(q, vec2(0.0)))
+    && all(lessThanEqual(q, vec2(1.0)));
+}
+
+// Distance along rd that the hits of the previous frame around the
+// reprojected pixel show to be empty, zero when there is nothing to reuse.
+// The pixel is found from the hit the previous frame kept at p, moved onto
+// the current ray and projected back, twice so larger moves settle.
+// Projecting the old hit points around it onto the new ray and taking the
+// closest one is conservative for small camera moves, the back-off covers
+// the rest.
+float reprojected_start(vec2 p, vec3 ro, vec3 rd) {
+  if (!reproject) {
+    return 0.0;
+  }
+
+  vec2 center = p;
+  for (int i = 0; i < 2; ++i) {
+    float d = texture(previous_distance, center).r;
+    if (d < 0.0) {
+      return 0.0;
+    }
+
+    vec3 hit = previous_camera[3].xyz + d * camera_ray(center, previous_camera);
+    center = previous_screen(ro + dot(hit - ro, rd) / dot(rd, rd) * rd);
+    if (!on_screen(center)) {
+      return 0.0;
+    }
+  }
+
+  vec2 texel = 1.0 / vec2(textureSize(previous_distance, 0));
+  float start = MAXIMUM_TRACE_DISTANCE;
+
+  for (int y = -1; y <= 1; ++y) {
+    for (int x = -1; x <= 1; ++x) {
+      vec2 q = center + vec2(x, y) * texel;
+      if (!on_screen(q)) {
+        return 0.0;
+      }
+
+      float d = texture(previous_distance, q).r;
+      if (d < 0.0) {
+        return 0.0;
+      }
+
+      vec3 hit = previous_camera[3].xyz + d * camera_ray(q, previous_camera);
+      start = min(start, dot(hit - ro, rd) / dot(rd, rd));
+    }
+  }
+
+  return max(0.0, start * REPROJECTION_BACKOFF);
+}
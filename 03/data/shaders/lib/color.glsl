@@ -0,0 +1,16 @@
+// colorings by march steps, a fractal picks one as its color
+
+#include "common.glsl"
+#include "march.glsl"
+
+vec4 step_gradient(march_result mr) {
+  float ratio = min(1.0, 1.2 - float(mr.steps) / max_steps);
+  float ratio2 = ratio * ratio;
+  return vec4(ratio, ratio2, 1.0 - ratio2 * ratio, 1.0);
+}
+
+vec4 step_grey(march_result mr) {
+  float ratio = 1.0 - max(0.2, float(mr.steps) / max_steps);
+  //ratio = ratio * ratio;
+  return vec4(ratio, ratio, ratio, 1.0);
+}
@@ -0,0 +1,73 @@
+// uniforms, outputs and constants every fractal shares
+
+precision highp float;
+
+// Per frame parameters every program shares, filled from
+// irg::frame_uniforms. Members that specialized programs may get as
+// defines are reached through the names below.
+layout (std140) uniform frame_uniforms {
+  // ray basis and position of the camera, see irg::ray_basis
+  mat4 camera;
+  mat4 previous_camera;
+  vec3 resolution;
+  float frame_power;
+  int frame_iterations;
+  int frame_max_steps;
+  float frame_min_distance;
+  float frame_hit_footprint;
+  float frame_relaxation;
+};
+
+// specialized programs get the parameters as defines, see main.cpp
+#ifdef ITERATIONS
+const int iterations = ITERATIONS;
+#else
+#define iterations frame_iterations
+#endif
+#ifdef POWER
+const float power = POWER;
+#else
+#define power frame_power
+#endif
+#ifdef MIN_DISTANCE
+const float min_distance = MIN_DISTANCE;
+#else
+#define min_distance frame_min_distance
+#endif
+#ifdef MAX_STEPS
+const int max_steps = MAX_STEPS;
+#else
+#define max_steps frame_max_steps
+#endif
+// hits within this fraction of a pixel, 0.0 uses min_distance instead
+#ifdef HIT_FOOTPRINT
+const float hit_footprint = HIT_FOOTPRINT;
+#else
+#define hit_footprint frame_hit_footprint
+#endif
+// over-relaxation of the march steps, 1.0 marches plainly
+#ifdef RELAXATION
+const float relaxation = RELAXATION;
+#else
+#define relaxation frame_relaxation
+#endif
+
+// hit distances of the previous frame, -1.0 for misses
+uniform bool reproject;
+uniform sampler2D previous_distance;
+
+// conservative start distances and steps per cone_block sized block
+uniform bool cone_pass;
+uniform bool cone_start;
+uniform int cone_block;
+uniform sampler2D cone_distance;
+
+// cone_pass writes its start distance and steps to location 0
+layout (location = 0) out vec4 frag_color;
+layout (location = 1) out float frag_distance;
+// march steps, distance estimator evaluations and termination of the pixel
+layout (location = 2) out uvec4 frag_cost;
+
+const float MAXIMUM_TRACE_DISTANCE = 100.0;
+// fraction of the reprojected distance that is trusted
+const float REPROJECTION_BACKOFF = 0.9;
@@ -0,0 +1,166 @@
+// distance estimators, a fractal picks one as its de and the matching
+// bounding volume as its bounds
+
+#include "common.glsl"
+#include "march.glsl"
+
+// x^n by squaring, n >= 0
+float int_pow(float x, int n) {
+  float result = 1.0;
+  for (; n > 0; n >>= 1) {
+    if ((n & 1) != 0) result *= x;
+    x *= x;
+  }
+  return result;
+}
+
+vec2 complex_mul(vec2 a, vec2 b) {
+  return vec2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+vec2 complex_pow(vec2 c, int n) {
+  vec2 result = vec2(1.0, 0.0);
+  for (; n > 0; n >>= 1) {
+    if ((n & 1) != 0) result = complex_mul(result, c);
+    c = complex_mul(c, c);
+  }
+  return result;
+}
+
+// The power step of the trigonometric loop below for an integer power n.
+// With rho = length(z.xy), r * (cos(theta), sin(theta)) is (z.z, rho) and
+// (cos(phi), sin(phi)) is z.xy / rho, so the multiplied angles come out of
+// complex powers of those.
+vec3 triplex_pow(vec3 z, int n) {
+  float rho = length(z.xy);
+  vec2 polar = complex_pow(vec2(z.z, rho), n);
+  vec2 azimuth = rho > 0.0 ? complex_pow(z.xy / rho, n) : vec2(1.0, 0.0);
+  return vec3(polar.y * azimuth.x, polar.y * azimuth.y, polar.x);
+}
+
+float mandelbulb_de(vec3 pos) {
+  const float Bailout = 256.0;
+  // Only programs specialized for a power take the integer path, its loops
+  // unroll there. Generic ones would carry both paths and run slower.
+#ifdef POWER
+  const bool integer_power = POWER >= 2.0 && POWER == floor(POWER);
+  const int n = int(POWER);
+#else
+  const bool integer_power = false;
+  const int n = 0;
+#endif
+
+  vec3 z = pos;
+  float dr = 1.0;
+  float r = 0.0;
+  for (int i = 0; i < iterations ; i++) {
+    r = length(z);
+
+    if (r > Bailout) break;
+
+    if (integer_power) {
+      dr = int_pow(r, n - 1) * power * dr + 1.0;
+      z = triplex_pow(z, n) + pos;
+      continue;
+    }
+    
+    float theta = acos(z.z/r);
+    float phi = atan(z.y,z.x);
+    dr = pow(r, power - 1.0) * power * dr + 1.0;
+    
+    float zr = pow(r, power);
+    theta = theta * power;
+    phi = phi * power;
+    
+    z = zr * vec3(sin(theta) * cos(phi), sin(phi) * sin(theta), cos(theta));
+    //z = zr * vec3(cos(theta) * cos(phi), cos(theta) * sin(phi), sin(theta));
+    z += pos;
+  }
+  return 0.5 * log(r) * r / dr;
+}
+
+float sierpinski_de(vec3 z) {
+  const vec3 Offset = vec3(1, 1, 1); 
+  const float Scale = 2.0;
+  float r;
+  int n = 0;
+  while (n < iterations) {
+    if (z.x + z.y < 0) z.xy = -z.yx; // fold 1
+    if (z.x + z.z < 0) z.xz = -z.zx; // fold 2
+    if (z.y + z.z < 0) z.zy = -z.yz; // fold 3	
+    z = z * Scale - Offset * (Scale - 1.0);
+    n++;
+  }
+  return length(z) * pow(Scale, -float(n));
+}
+
+float distance_from_sphere(in vec3 p, in vec3 c, float r) {
+  return max(0.0, length(p - c) - r);
+}
+
+float balls_de(vec3 p) {
+  const vec3 c = vec3(5.0, 2.0, 2.0);
+  return 
+    distance_from_sphere(mod(p + 0.5 * c, c) - 0.5 * c, vec3(0.0), 0.5);
+}
+
+float single_ball_de(vec3 p) {
+  return distance_from_sphere(p, vec3(0.0, 0.0, 3.0), 2.0);
+}
+
+// Bounding volumes give the interval [entry, exit] of the ray parameter
+// where a hit is possible, entry > exit when the ray misses. They are grown
+// by the hit distance at their far side, since hits are reported that far
+// from the surface. rd is not normalized, its length is at least 0.5.
+
+vec2 unbounded() {
+  return vec2(0.0, MAXIMUM_TRACE_DISTANCE);
+}
+
+vec2 sphere_bounds(vec3 ro, vec3 rd, vec3 c, float r) {
+  vec3 oc = ro - c;
+  r += hit_distance(2.0 * (length(oc) + r));
+  float a = dot(rd, rd);
+  float b = dot(oc, rd);
+  float discriminant = b * b - a * (dot(oc, oc) - r * r);
+  if (discriminant < 0.0) {
+    return vec2(1.0, 0.0);
+  }
+  float root = sqrt(discriminant);
+  return vec2(
+    max(0.0, (-b - root) / a), min(MAXIMUM_TRACE_DISTANCE, (-b + root) / a));
+}
+
+vec2 box_bounds(vec3 ro, vec3 rd, vec3 low, vec3 high) {
+  float reach = length(ro - 0.5 * (low + high)) + 0.5 * length(high - low);
+  float margin = hit_distance(2.0 * reach);
+  vec3 inverse = 1.0 / rd;
+  vec3 t0 = (low - margin - ro) * inverse;
+  vec3 t1 = (high + margin - ro) * inverse;
+  vec3 near = min(t0, t1);
+  vec3 far = max(t0, t1);
+  return vec2(
+    max(0.0, max(near.x, max(near.y, near.z))),
+    min(MAXIMUM_TRACE_DISTANCE, min(far.x, min(far.y, far.z))));
+}
+
+// Once |z| >= |pos| > 2^(1 / (power - 1)) every iteration grows |z|, so
+// the bulb lies within that radius. The margin covers the estimate being
+// loose near it.
+vec2 mandelbulb_bounds(vec3 ro, vec3 rd) {
+  if (power <= 1.0) {
+    return unbounded();
+  }
+  float radius = pow(2.0, 1.0 / (power - 1.0));
+  return sphere_bounds(
+    ro, rd, vec3(0.0), min(radius * 1.1, MAXIMUM_TRACE_DISTANCE));
+}
+
+// the folds and scalings keep the tetrahedron within its corners
+vec2 sierpinski_bounds(vec3 ro, vec3 rd) {
+  return box_bounds(ro, rd, vec3(-1.0), vec3(1.0));
+}
+
+vec2 single_ball_bounds(vec3 ro, vec3 rd) {
+  return sphere_bounds(ro, rd, vec3(0.0, 0.0, 3.0), 2.0);
+}
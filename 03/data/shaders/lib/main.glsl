@@ -0,0 +1,70 @@
+// cone prepass, reprojection and the march of every pixel, the including
+// fractal provides de, bounds and color
+
+#include "common.glsl"
+#include "march.glsl"
+#include "camera.glsl"
+
+vec4 color(march_result mr);
+// interval of the ray where de can report a hit, see distance.glsl
+vec2 bounds(vec3 ro, vec3 rd);
+
+void main() {
+  vec3 camera_position = camera[3].xyz;
+
+  if (cone_pass) {
+    vec2 center = gl_FragCoord.xy * float(cone_block) / resolution.xy;
+    vec3 cone_rd = camera_ray(center, camera);
+    int evaluations;
+    frag_color = vec4(
+      cone_march(camera_position, cone_rd, evaluations), 0.0, 0.0);
+    // the steps are counted by the pixels starting from the cone
+    frag_cost = uvec4(0u, uint(evaluations), 0u, 0u);
+    return;
+  }
+
+  vec2 p = gl_FragCoord.xy / resolution.xy;
+  vec3 rd = camera_ray(p, camera);
+
+  vec2 cone = vec2(0.0);
+  if (cone_start) {
+    cone = texelFetch(
+      cone_distance, ivec2(gl_FragCoord.xy) / cone_block, 0).rg;
+  }
+  int first_step = int(cone.y);
+
+  vec2 volume = bounds(camera_position, rd);
+  // a miss is reported like a ray marched past the trace distance
+  if (volume.x > volume.y) {
+    frag_distance = -1.0;
+    frag_cost = uvec4(max_steps, 0u, MARCH_ESCAPED, 0u);
+    frag_color = vec4(vec3(0.0), 1.0);
+    return;
+  }
+
+  float safe = cone.x;
+  // the jump to the volume stands in for the long first step of a plain
+  // march, so the step colors stay about the same
+  if (volume.x > safe) {
+    safe = volume.x;
+    ++first_step;
+  }
+
+  float start = max(safe, reprojected_start(p, camera_position, rd));
+  march_result mr = ray_march(
+    camera_position, rd, start, volume.y, first_step);
+  // landing on a surface right away means the seed may have skipped one
+  if (start > safe && mr.steps == first_step + 1) {
+    int wasted = mr.evaluations;
+    mr = ray_march(camera_position, rd, safe, volume.y, first_step);
+    mr.evaluations += wasted;
+  }
+  frag_distance = mr.distance;
+  frag_cost = uvec4(mr.steps, mr.evaluations, mr.termination, 0u);
+
+  if (mr.distance > 0.0) {
+    frag_color = color(mr);
+  } else {
+    frag_color = vec4(vec3(0.0), 1.0);
+  }
+}
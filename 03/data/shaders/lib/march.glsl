@@ -0,0 +1,127 @@
+// sphere tracing against the de of the including fractal
+
+#include "common.glsl"
+
+float de(vec3 p);
+
+// Distances of de are scaled by this before stepping. A fractal whose
+// estimate overshoots defines a smaller factor before including this file.
+#ifndef LIPSCHITZ_FACTOR
+#define LIPSCHITZ_FACTOR 1.0
+#endif
+
+// how far neighbouring primary rays drift apart per unit of distance
+float pixel_spread() {
+  return 2.0 * length(camera[1].xyz) / resolution.y;
+}
+
+// Distance from the surface that counts as a hit at distance_traveled
+// along a ray. With a footprint the surface is refined to a fraction of
+// the pixel it covers, far surfaces stop early and close ups get as fine
+// as they need.
+float hit_distance(float distance_traveled) {
+  if (hit_footprint > 0.0) {
+    return distance_traveled * hit_footprint * pixel_spread();
+  }
+  return min_distance;
+}
+
+// how a march ended, written to frag_cost.z
+const uint MARCH_HIT = 1u;
+const uint MARCH_ESCAPED = 2u;
+const uint MARCH_EXHAUSTED = 3u;
+
+struct march_result {
+  vec3 position;
+  int steps;
+  float distance;
+  int evaluations;
+  uint termination;
+};
+
+// ray origin => the starting point
+// ray direction => direction of the ray
+// start => distance along the ray known to be empty
+// end => distance past which the ray cannot hit anything
+// first_step => steps already spent on reaching start
+//
+// With relaxation above 1.0 every step is that many times the distance,
+// as in enhanced sphere tracing by Keinert et al. Once the unbounding
+// spheres of two consecutive points stop overlapping the last step may
+// have skipped a surface, the march goes back to where a plain step would
+// have ended and marches plainly from there on.
+march_result ray_march(
+    in vec3 ro, in vec3 rd, float start, float end, int first_step) {
+  float distance_traveled = start;
+  int evaluations = 0;
+
+  float omega = relaxation;
+  float previous_closest = 0.0;
+  float step_length = 0.0;
+
+  for (int i = first_step; i < max_steps; ++i) {
+    vec3 current_position = ro + distance_traveled * rd;
+    
+    float closest = de(current_position) * LIPSCHITZ_FACTOR;
+    ++evaluations;
+
+    if (omega > 1.0 && closest + previous_closest < step_length) {
+      distance_traveled -= step_length - previous_closest;
+      omega = 1.0;
+      continue;
+    }
+
+    if (closest < hit_distance(distance_traveled)) {
+      return march_result(
+        current_position, i + 1, distance_traveled, evaluations, MARCH_HIT);
+    }
+
+    // only the plain step is known to be empty, a relaxed one past end
+    // may yet be stepped back
+    if (distance_traveled + closest > end) {
+      distance_traveled += closest;
+      return march_result(
+        ro + distance_traveled * rd, max_steps, -1.0, evaluations, 
+        MARCH_ESCAPED);
+    }
+
+    previous_closest = closest;
+    step_length = closest * omega;
+    distance_traveled += step_length;
+  }
+
+  return march_result(
+    ro + distance_traveled * rd,
+    max_steps, 
+    -1.0,
+    evaluations,
+    MARCH_EXHAUSTED
+  );
+}
+
+// Marches the cone enclosing the rays of a block of pixels. Its radius
+// grows with the half diagonal of the block. Returns the last distance
+// where the cone was still free of the surface and the steps needed to get
+// there, evaluations counts the calls of de.
+vec2 cone_march(vec3 ro, vec3 rd, out int evaluations) {
+  float slope = float(cone_block) * 0.70711 * pixel_spread();
+  float safe = 0.0;
+  float distance_traveled = 0.0;
+  evaluations = 0;
+
+  for (int i = 0; i < max_steps; ++i) {
+    float closest = de(ro + distance_traveled * rd) * LIPSCHITZ_FACTOR;
+    ++evaluations;
+    if (closest < distance_traveled * slope) {
+      return vec2(safe, float(max(0, i - 1)));
+    }
+
+    safe = distance_traveled;
+    distance_traveled += closest;
+    if (distance_traveled > MAXIMUM_TRACE_DISTANCE) {
+      return vec2(safe, float(i));
+    }
+  }
+
+  return vec2(safe, float(max_steps - 1));
+}
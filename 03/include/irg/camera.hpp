@@ -7,6 +7,7 @@
 #include <glm/gtx/quaternion.hpp>
 
 #include <irg/keyboard.hpp>
+#include <irg/ray_basis.hpp>
 
 namespace irg {
 
@@ -23,12 +24,23 @@ namespace irg {
     ::glm::vec2 zoom_sensitivity = {0.02, 0.02};
     ::glm::vec2 zoom_mask        = {0.0, 0.0};
 
+    // vertical, in radians
+    float fov = ::glm::radians(90.0f);
+
     camera() = default;
     camera(::glm::vec3 const& position, ::glm::vec3 const& target)
       : position(position), target(target) {}
     
+    bool moving() const noexcept {
+      ::glm::vec2 const still{0.0, 0.0};
+      return position_mask != still || target_mask != still 
+        || zoom_mask != still;
+    }
+
     ::glm::mat4 view_matrix() noexcept;
-    void update() noexcept;
+    ::glm::mat4 ray_basis() const noexcept;
+    // applies the masks, returns whether the camera moved
+    bool update() noexcept;
   };
 
   ::irg::keyboard_event_type::on_press standard_camera_controler(camera& c);
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <condition_variable>
+
+#include <glad/glad.h>
+
+#include <irg/gif.hpp>
+#include <irg/image.hpp>
+#include <irg/thread_pool.hpp>
+
+namespace irg {
+
+  // Where captured frames go, parsed from "png:<prefix>" for a sequence of
+  // <prefix>NNNN.png files, "y4m:<path>" for a raw 4:4:4 YUV4MPEG2 video,
+  // "pipe:<command>" for a shell command reading raw rgb24 frames on stdin,
+  // or "gif:<path>" for a looping GIF. GIF frames get palettes of their own,
+  // with "gif-global:<path>" they share the one of the first frame.
+  struct capture_target {
+    enum class format {
+      png,
+      y4m,
+      pipe,
+      gif,
+      gif_global,
+    };
+
+    format kind = format::png;
+    ::std::string destination;
+  };
+
+  // false if spec names no known format
+  bool parse_capture_target(char const* spec, capture_target& target);
+
+  // Target of the clip called name, one of several captured in one run.
+  // Image sequences get "<name>_" appended to their prefix, files "_<name>"
+  // before their extension. False for pipes, their command is the same for
+  // every clip.
+  bool clip_capture_target(capture_target const& target,
+                           ::std::string const& name, capture_target& clip);
+
+  // Encodes and writes frames on a pool of threads. Image sequences are
+  // written as their frames finish, streams in order. Callers block while
+  // too many frames are queued, so memory stays bounded when the disk or
+  // the command can not keep up. Streams take the size of their first
+  // frame, later frames of another size are dropped.
+  class frame_writer {
+   public:
+    // frames per second are recorded in y4m headers
+    frame_writer(
+      capture_target target, double const fps,
+      unsigned const threads = ::std::thread::hardware_concurrency());
+    ~frame_writer();
+
+    frame_writer(frame_writer const&) = delete;
+    frame_writer& operator=(frame_writer const&) = delete;
+
+    // false if the destination could not be opened
+    bool open();
+
+    void write(image&& frame);
+
+    // waits for every frame and closes the stream, false if any frame
+    // could not be written
+    bool finish();
+
+    ::std::uint64_t written() const noexcept {
+      return submitted;
+    }
+
+   private:
+    capture_target target;
+    double fps;
+    thread_pool pool;
+
+    ::std::unique_ptr<::std::FILE, int(*)(::std::FILE*)> stream{
+      nullptr, ::std::fclose};
+
+    ::std::mutex m;
+    ::std::condition_variable room;
+    ::std::size_t queued = 0;
+    ::std::size_t const limit;
+    bool failed = false;
+
+    ::std::uint64_t submitted = 0;
+    int width  = 0;
+    int height = 0;
+    bool warned = false;
+    gif::palette global;
+
+    // encoded frames waiting for the ones before them
+    ::std::mutex order;
+    ::std::map<::std::uint64_t, ::std::vector<unsigned char>> done;
+    ::std::uint64_t next = 0;
+
+    void encode(::std::uint64_t const index, image const& frame);
+    void emit(::std::uint64_t const index,
+              ::std::vector<unsigned char>&& bytes);
+  };
+
+  // Reads rendered frames back through a ring of pixel buffer objects.
+  // Every capture only queues a copy into the next buffer and a fence,
+  // finished copies are mapped and handed to the writer frames later, so
+  // the render thread only waits once the whole ring is still in flight.
+  class frame_capture {
+   public:
+    explicit frame_capture(frame_writer& writer,
+                           ::std::size_t const ring_size = 3);
+    ~frame_capture();
+
+    frame_capture(frame_capture const&) = delete;
+    frame_capture& operator=(frame_capture const&) = delete;
+
+    // starts reading color attachment 0 of fbo, 0 for the back buffer of
+    // the window
+    void capture(unsigned const fbo, int const width, int const height);
+
+    // hands finished copies to the writer without waiting
+    void poll();
+
+    // waits for every copy
+    void flush();
+
+   private:
+    struct slot {
+      unsigned buffer = 0;
+      ::std::size_t capacity = 0;
+      ::GLsync fence = nullptr;
+      int width  = 0;
+      int height = 0;
+    };
+
+    frame_writer& writer;
+    ::std::vector<slot> ring;
+    // oldest copy in flight and the number of them
+    ::std::size_t first = 0;
+    ::std::size_t pending = 0;
+
+    bool take(bool const wait);
+  };
+
+}
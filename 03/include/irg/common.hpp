@@ -20,15 +20,35 @@ namespace irg {
     callable c;
   };
 
+  namespace detail {
+    // loader glad was initialized with
+    extern ::GLADloadproc proc_loader;
+  }
+
   void terminate(char const* err);
 
+  // address of a GL function newer than the 3.3 core glad was generated
+  // for, nullptr if the context does not provide it
+  void* gl_proc_address(char const* name);
+
   void assert_no_error();
 
   on_scope_exit init(int const major_version = 3, int const minor_version = 3);
 
   ::GLFWwindow* create_window(int const width = 800, int const height = 600);
 
-  void window_loop(::GLFWwindow* window, ::std::function<void(void)> render);
+  // Calls update every iteration and render only when update reports a
+  // change or the window was invalidated, otherwise sleeps until the next
+  // event. Without update every iteration renders.
+  void window_loop(::GLFWwindow* window, ::std::function<void(void)> render,
+                   ::std::function<bool(void)> update = {});
+
+  // forces the next window_loop iteration to render
+  void invalidate() noexcept;
+
+  // the next window_loop iteration sleeps for a few milliseconds at most,
+  // for work that has to be polled
+  void wake_soon() noexcept;
 
   void bind_events(::GLFWwindow* window);
 
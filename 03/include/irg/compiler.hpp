@@ -0,0 +1,90 @@
+#pragma once
+
+#include <list>
+#include <deque>
+#include <mutex>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include <optional>
+#include <functional>
+#include <condition_variable>
+
+#include <irg/common.hpp>
+#include <irg/shader.hpp>
+
+namespace irg {
+
+  struct build_result {
+    ::std::optional<shader_program> program;
+    // compile or link errors if there is no program
+    ::std::string log;
+  };
+
+  // Builds programs without stalling the render thread. Where the context
+  // has GL_KHR_parallel_shader_compile the driver builds on its own threads
+  // and poll, called on the render thread, hands out what is done. Otherwise
+  // a pool of workers with hidden windows, whose contexts share objects with
+  // the one current at construction, builds them. Without either (headless
+  // on a driver without the extension) programs are built right away on the
+  // calling thread.
+  class background_compiler {
+   public:
+    // windowed: hidden windows may be opened for the workers. notify is
+    // called whenever poll has something to do, from any thread, for
+    // example to wake up glfwWaitEvents.
+    explicit background_compiler(bool const windowed,
+                                 ::std::function<void(void)> notify = {});
+    ~background_compiler();
+
+    background_compiler(background_compiler const&) = delete;
+    background_compiler& operator=(background_compiler const&) = delete;
+
+    // may be called from any thread
+    ::std::future<build_result> submit(program_sources sources);
+
+    // Finishes parallel builds that are done and starts submitted ones,
+    // render thread only. True while builds are still running, they have to
+    // be polled again soon since the driver does not signal them.
+    bool poll();
+
+    // waits for a future of this compiler, render thread only
+    void wait(::std::future<build_result> const& f);
+
+    // false if builds run on the calling thread
+    bool asynchronous() const noexcept {
+      return parallel || !workers.empty();
+    }
+
+   private:
+    struct job {
+      program_sources sources;
+      ::std::promise<build_result> promise;
+    };
+
+    struct in_flight {
+      shader_program::pending build;
+      ::std::promise<build_result> promise;
+    };
+
+    ::std::function<void(void)> notify;
+    // the driver builds in parallel, see GL_KHR_parallel_shader_compile
+    bool parallel = false;
+
+    ::std::mutex m;
+    ::std::condition_variable job_available;
+    ::std::deque<job> jobs;
+    bool stopping = false;
+
+    // builds the driver is working on, render thread only
+    ::std::list<in_flight> running;
+
+    ::std::vector<::GLFWwindow*> contexts;
+    ::std::vector<::std::thread> workers;
+
+    void run(::GLFWwindow* context);
+    void finish(in_flight& f);
+  };
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include <irg/image.hpp>
+#include <irg/thread_pool.hpp>
+
+// CPU port of the distance estimators and the ray_march loop from
+// data/shaders. Rays are traced in packets of simd::width lanes, image tiles
+// are spread over a work stealing pool.
+
+namespace irg::cpu {
+
+  enum class estimator {
+    mandelbulb,
+    sierpinski,
+    balls,
+    single_ball,
+  };
+
+  enum class coloring {
+    steps,           // blue to yellow gradient of mandelbulb.glsl
+    steps_grayscale, // mandelbulb_light.glsl
+  };
+
+  struct scene {
+    estimator de   = estimator::mandelbulb;
+    coloring color = coloring::steps;
+    // infinite_balls_mirrored.glsl mirrors the left half of the screen
+    bool mirrored = false;
+  };
+
+  // picks the scene matching one of the files in data/shaders
+  bool scene_from_shader(::std::string const& path, scene& s);
+
+  struct march_parameters {
+    int iterations     = 8;
+    float power        = 4.0;
+    float min_distance = 0.001;
+    int max_steps      = 64;
+  };
+
+  struct render_stats {
+    ::std::uint64_t rays  = 0;
+    ::std::uint64_t steps = 0;
+  };
+
+  // fov is in radians, as camera::fov
+  render_stats render(thread_pool& pool, scene const& s,
+                      march_parameters const& params,
+                      ::glm::vec3 const& camera_position,
+                      ::glm::vec3 const& camera_target, float const fov,
+                      image& out, int const tile_size = 32);
+
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include <glad/glad.h>
+
+#include <irg/common.hpp>
+#include <irg/image.hpp>
+#include <irg/ownership.hpp>
+
+namespace irg {
+
+  namespace detail {
+    struct texture_format {
+      unsigned format;
+      unsigned type;
+      int filter;
+    };
+
+    // upload format compatible with an internal format, data is never sent
+    inline texture_format format_of(unsigned const internal) noexcept {
+      switch (internal) {
+        case GL_R32F:     return {GL_RED, GL_FLOAT, GL_NEAREST};
+        case GL_RG32F:    return {GL_RG, GL_FLOAT, GL_NEAREST};
+        case GL_RGBA32F:  return {GL_RGBA, GL_FLOAT, GL_NEAREST};
+        case GL_R32UI:    return {GL_RED_INTEGER, GL_UNSIGNED_INT, GL_NEAREST};
+        case GL_RGBA32UI: return {GL_RGBA_INTEGER, GL_UNSIGNED_INT, GL_NEAREST};
+        default:          return {GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR};
+      }
+    }
+  }
+
+  // Offscreen render target, one texture per color attachment. Attachment 0
+  // is the image, further ones carry per pixel data for later passes.
+  class framebuffer {
+    shared_ownership<unsigned> fbo;
+    ::std::vector<shared_ownership<unsigned>> textures;
+
+   public:
+    int width;
+    int height;
+
+    framebuffer(int const width, int const height, 
+                ::std::vector<unsigned> const& formats = {GL_RGBA8})
+      : fbo(deffer_ownership(
+          new unsigned{0},
+          [](auto* ptr) {
+            glDeleteFramebuffers(1, ptr);
+          }
+        ))
+      , width(width)
+      , height(height)
+    {
+      glGenFramebuffers(1, fbo.get());
+      glBindFramebuffer(GL_FRAMEBUFFER, *fbo);
+
+      ::std::vector<unsigned> draw_buffers;
+      for (auto const internal : formats) {
+        auto& texture = textures.emplace_back(deffer_ownership(
+          new unsigned{0},
+          [](auto* ptr) {
+            glDeleteTextures(1, ptr);
+          }
+        ));
+        glGenTextures(1, texture.get());
+
+        auto const f = detail::format_of(internal);
+        glBindTexture(GL_TEXTURE_2D, *texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internal, width, height, 0, 
+                     f.format, f.type, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, f.filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, f.filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        auto const attachment = GL_COLOR_ATTACHMENT0 + draw_buffers.size();
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, 
+                               GL_TEXTURE_2D, *texture, 0);
+        draw_buffers.push_back(attachment);
+      }
+
+      glDrawBuffers(draw_buffers.size(), draw_buffers.data());
+
+      if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        ::irg::terminate("Incomplete framebuffer.");
+
+      glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // binds for drawing and matches the viewport
+    void bind() const noexcept {
+      glBindFramebuffer(GL_FRAMEBUFFER, *fbo);
+      glViewport(0, 0, width, height);
+    }
+
+    unsigned id() const noexcept {
+      return *fbo;
+    }
+
+    unsigned texture(::std::size_t const attachment = 0) const noexcept {
+      return *textures[attachment];
+    }
+
+    // reads the color attachment back, blocks until rendering is done
+    void read(image& out) const {
+      out = image{width, height};
+
+      glBindFramebuffer(GL_READ_FRAMEBUFFER, *fbo);
+      glReadBuffer(GL_COLOR_ATTACHMENT0);
+      glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+      glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, 
+                   out.pixels.data());
+
+      // GL rows start at the bottom
+      for (int y = 0; y < height / 2; ++y)
+        ::std::swap_ranges(out.row(y), out.row(y) + width * 3, 
+                           out.row(height - 1 - y));
+    }
+  };
+
+}
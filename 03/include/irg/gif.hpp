@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+
+#include <irg/image.hpp>
+
+// Animated GIF encoding in pieces, so frames can be encoded independently
+// and streamed: a header, any number of frames, the trailer.
+
+namespace irg::gif {
+
+  // RGB triples, at most 256 colors
+  using palette = ::std::vector<unsigned char>;
+
+  // median cut over a histogram of 5 bits per channel
+  palette quantize(image const& img, int const colors = 256);
+
+  // screen descriptor, the global palette unless it is empty, and looping
+  void header(int const width, int const height, palette const& global,
+              ::std::vector<unsigned char>& out);
+
+  // Appends a frame shown for delay hundredths of a second, dithered to the
+  // global palette, or to one of its own if global is empty.
+  void frame(image const& img, palette const& global, int const delay,
+             ::std::vector<unsigned char>& out);
+
+  unsigned char constexpr trailer = 0x3b;
+
+}
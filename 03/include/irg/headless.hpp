@@ -0,0 +1,12 @@
+#pragma once
+
+#include <irg/common.hpp>
+
+namespace irg {
+
+  // Creates a surfaceless EGL context and makes it current, no window system
+  // required. Works with Mesa llvmpipe on servers without a display.
+  on_scope_exit init_headless(int const major_version = 3, 
+                              int const minor_version = 3);
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+namespace irg {
+
+  // 8-bit RGB image, rows stored top to bottom
+  struct image {
+    int width  = 0;
+    int height = 0;
+    ::std::vector<unsigned char> pixels;
+
+    image() = default;
+    image(int const width, int const height)
+      : width(width), height(height), pixels(width * height * 3) {}
+
+    unsigned char* row(int const y) noexcept {
+      return pixels.data() + y * width * 3;
+    }
+
+    unsigned char const* row(int const y) const noexcept {
+      return pixels.data() + y * width * 3;
+    }
+  };
+
+  // returns false if the file could not be written
+  bool write_ppm(char const* path, image const& img);
+
+  // lossless RGB PNG, compressed with the fixed deflate codes
+  void encode_png(image const& img, ::std::vector<unsigned char>& out);
+  bool write_png(char const* path, image const& img);
+
+}
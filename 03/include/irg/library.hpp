@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <future>
+#include <string>
+#include <cstddef>
+#include <optional>
+
+#include <irg/shader.hpp>
+#include <irg/reload.hpp>
+#include <irg/compiler.hpp>
+#include <irg/variants.hpp>
+
+namespace irg {
+
+  // Fragment shaders to switch between at runtime. All of them are handed
+  // to the compiler up front, so a selected fractal is usually linked by the
+  // time it is asked for. Switching replaces the program the caller draws
+  // with, uniform values and with them the camera and parameters carry over.
+  // Every fractal keeps its own specialized variants.
+  class fractal_library {
+   public:
+    // builds the first fractal right away and terminates if it is broken
+    fractal_library(::std::vector<::std::string> const& paths,
+                    ::std::string const& vertex_source,
+                    background_compiler& compiler);
+
+    fractal_library(fractal_library const&) = delete;
+    fractal_library& operator=(fractal_library const&) = delete;
+
+    ::std::size_t size() const noexcept {
+      return fractals.size();
+    }
+
+    ::std::size_t active() const noexcept {
+      return current;
+    }
+
+    ::std::string const& path(::std::size_t const i) const noexcept {
+      return fractals[i].path;
+    }
+
+    // the file name without its extension
+    ::std::string const& name(::std::size_t const i) const noexcept {
+      return fractals[i].name;
+    }
+
+    // generic program of the active fractal
+    shader_program const& program() const noexcept {
+      return *fractals[current].program;
+    }
+
+    // switches on a later poll once fractal i is built, right away if it
+    // already is
+    void select(::std::size_t const i);
+
+    // collects finished builds and carries out a pending switch
+    void poll(shader_program& program);
+
+    // like poll, but waits for the selected fractal to finish building
+    void wait(shader_program& program);
+
+    // takes over a rebuild of the active fractal
+    void reload(shader_program& program, reloaded_program next);
+
+    // specializes the active fractal, see program_variants
+    void request(shader_program& program, defines const& d);
+
+   private:
+    struct fractal {
+      ::std::string path;
+      ::std::string name;
+      program_sources sources;
+
+      ::std::future<build_result> building;
+      ::std::optional<shader_program> program;
+      ::std::optional<program_variants> variants;
+      bool broken = false;
+    };
+
+    background_compiler& compiler;
+
+    ::std::vector<fractal> fractals;
+    ::std::size_t current = 0;
+    ::std::size_t selected = 0;
+
+    // moves the result of a finished build into f
+    void collect(fractal& f);
+    void activate(shader_program& program, ::std::size_t const i);
+  };
+
+}
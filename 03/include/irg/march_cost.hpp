@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <irg/image.hpp>
+#include <irg/shader.hpp>
+#include <irg/framebuffer.hpp>
+
+// Per pixel cost of a march as written by the shaders to frag_cost: steps,
+// distance estimator evaluations and how the march terminated.
+
+namespace irg {
+
+  enum class termination : unsigned {
+    none      = 0, // pixel was not marched
+    hit       = 1,
+    escaped   = 2, // past MAXIMUM_TRACE_DISTANCE
+    exhausted = 3, // ran out of max_steps
+  };
+
+  struct march_cost {
+    int width  = 0;
+    int height = 0;
+    // steps, evaluations, termination and padding per pixel, rows bottom up
+    ::std::vector<unsigned> pixels;
+
+    unsigned const* at(int const x, int const y) const noexcept {
+      return pixels.data() + (static_cast<::std::size_t>(y) * width + x) * 4;
+    }
+  };
+
+  // reads an GL_RGBA32UI attachment, blocks until rendering is done
+  void read_march_cost(framebuffer const& source,
+                       ::std::size_t const attachment, march_cost& out);
+
+  struct march_statistics {
+    ::std::uint64_t pixels      = 0;
+    ::std::uint64_t steps       = 0;
+    ::std::uint64_t evaluations = 0;
+    // of the cone prepass, also part of evaluations
+    ::std::uint64_t cone_evaluations = 0;
+    ::std::array<::std::uint64_t, 4> terminations{};
+    // number of pixels for every count of steps and evaluations
+    ::std::vector<::std::uint64_t> step_histogram;
+    ::std::vector<::std::uint64_t> evaluation_histogram;
+  };
+
+  // cone is the cost the cone prepass of the frame wrote, if it ran
+  march_statistics reduce(march_cost const& cost,
+                          march_cost const* cone = nullptr);
+
+  // totals as comments followed by the histograms as CSV, false on failure
+  bool write_statistics(char const* path, march_statistics const& stats);
+
+  // evaluations relative to max_steps from blue over green to red, white
+  // where the step budget ran out
+  void heatmap(march_cost const& cost, int const max_steps, image& out);
+
+  // Blends the heatmap of a cost attachment over the currently bound
+  // framebuffer, computed on the GPU so it can follow every frame.
+  class cost_overlay {
+   public:
+    float opacity = 0.75;
+
+    cost_overlay();
+
+    void draw(framebuffer const& source, ::std::size_t const attachment,
+              int const max_steps);
+
+   private:
+    shader_program program;
+    shared_ownership<unsigned> vao;
+  };
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+
+namespace irg {
+
+  // Resolves #include "file" lines of a shader, paths are relative to the
+  // including file and every file is included at most once. Included text
+  // is framed by #line directives with a source string number per file, the
+  // numbers are mapped back to paths by remap_log. Files are cached and
+  // only read again once they change on disk.
+  // Returns nothing and explains why in error if a file can not be read.
+  ::std::optional<::std::string> preprocess(::std::string const& path,
+                                            ::std::string& error);
+
+  // paths of the files a preprocessed source was made of, the root first
+  ::std::vector<::std::string> included_files(::std::string const& source);
+
+  // replaces source string numbers at the start of compiler messages with
+  // the paths of the files they refer to
+  ::std::string remap_log(::std::string const& log,
+                          ::std::string const& source);
+
+}
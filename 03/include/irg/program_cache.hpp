@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+// Linked programs stored on disk as driver binaries (glGetProgramBinary),
+// keyed by a hash of the sources and the driver that produced them. Does
+// nothing until opened or when the driver offers no binary formats.
+
+namespace irg::program_cache {
+
+  // enables the cache in directory, creating it if needed
+  void open(::std::string const& directory);
+
+  // $XDG_CACHE_HOME/fractals or ~/.cache/fractals
+  ::std::string default_directory();
+
+  bool enabled() noexcept;
+
+  // hash of both sources and the vendor, renderer and version strings of
+  // the current context, defines injected into a source are part of it
+  ::std::uint64_t key(::std::string const& vertex_source,
+                      ::std::string const& fragment_source);
+
+  // links program from the binary stored under key, false on a miss or if
+  // the driver rejected the binary
+  bool load(unsigned const program, ::std::uint64_t const key);
+
+  // asks the driver to keep the binary around, call before linking
+  void prepare(unsigned const program);
+
+  // saves the binary of a linked program under key
+  void store(unsigned const program, ::std::uint64_t const key);
+
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <map>
+#include <tuple>
+#include <chrono>
+#include <vector>
+#include <functional>
+
+#include <glm/glm.hpp>
+
+#include <irg/framebuffer.hpp>
+
+namespace irg {
+
+  // Renders into a scaled offscreen target and upscales it to the window.
+  // While the camera moves the scale adapts to stay within the frame budget,
+  // once it stops every redraw doubles the scale up to max_scale, which can
+  // be above 1 to supersample the still image.
+  class progressive_resolution {
+   public:
+    float min_scale = 0.125;
+    float max_scale = 1.0;
+    // below this frame rate the motion scale drops, well above it it rises
+    double target_fps = 60.0;
+
+    // formats of the color attachments of the offscreen targets
+    progressive_resolution(int const width, int const height,
+                           ::std::vector<unsigned> formats = {GL_RGBA8})
+      : width(width), height(height), formats(::std::move(formats)) {}
+
+    void resize(int const w, int const h) noexcept;
+
+    // Decides the scale of the next frame, true if it has to be marched.
+    // changed: the scene changed since the last call.
+    bool advance(bool const changed, bool const moving) noexcept;
+
+    // resolution the next march should be done at
+    ::glm::ivec2 resolution() const noexcept;
+
+    // Marches into a fresh target if a frame is pending, then upscales the
+    // latest target to the window. march gets the bound target and the one
+    // of the frame before, which stays intact for reading, or nullptr.
+    using march_callback = 
+      ::std::function<void(framebuffer const&, framebuffer const*)>;
+    void render(march_callback const& march);
+
+    float scale() const noexcept {
+      return current_scale;
+    }
+
+    // target of the latest march, nullptr before the first one
+    framebuffer const* current() const noexcept {
+      return latest;
+    }
+
+   private:
+    using clock = ::std::chrono::steady_clock;
+
+    int width;
+    int height;
+    ::std::vector<unsigned> formats;
+
+    float motion_scale  = 0.5;
+    float current_scale = 1.0;
+    bool pending = true;
+    bool resized = false;
+
+    bool was_moving = false;
+    clock::time_point last_frame;
+
+    // two targets per size, so the previous frame can be read from while the
+    // next one is drawn
+    using target_key = ::std::tuple<int, int, int>;
+    ::std::map<target_key, framebuffer> targets;
+    framebuffer* latest = nullptr;
+    target_key latest_key;
+  };
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+namespace irg {
+
+  // Basis the shaders build primary rays from: right and up scaled to the
+  // field of view, forward, and the position as the last column. The ray
+  // through uv in [-1, 1]^2, x stretched by the aspect ratio, is
+  // mat3(basis) * (uv, 1). Rays are half length, which step counts and
+  // the colors derived from them were always tuned to. Header only, so
+  // cpu.out shares it without the window code.
+  inline ::glm::mat4 ray_basis(::glm::vec3 const& position,
+                               ::glm::vec3 const& target, float const fov) {
+    auto const forward = ::glm::normalize(target - position);
+
+    // looking straight up or down any horizontal right will do
+    auto right = ::glm::cross(forward, ::glm::vec3{0.0, 1.0, 0.0});
+    if (::glm::dot(right, right) < 1e-12f)
+      right = {1.0, 0.0, 0.0};
+    right = ::glm::normalize(right);
+    auto const up = ::glm::cross(right, forward);
+
+    auto const spread = ::std::tan(0.5f * fov);
+    return {
+      ::glm::vec4{0.5f * spread * right, 0.0},
+      ::glm::vec4{0.5f * spread * up, 0.0},
+      ::glm::vec4{0.5f * forward, 0.0},
+      ::glm::vec4{position, 1.0},
+    };
+  }
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <future>
+#include <thread>
+#include <vector>
+#include <optional>
+
+#include <irg/shader.hpp>
+#include <irg/compiler.hpp>
+
+namespace irg {
+
+  struct reloaded_program {
+    program_sources sources;
+    shader_program program;
+  };
+
+  // Watches a fragment shader and the files it includes with inotify and
+  // rebuilds the program in the background whenever one of them is written.
+  // Finished programs are picked up with take, broken ones are logged and
+  // dropped so the caller keeps drawing with what it has. Needs an
+  // asynchronous compiler.
+  class shader_reloader {
+   public:
+    // the compiler notifies once a rebuild is ready to be taken
+    shader_reloader(::std::string path, ::std::string vertex_source,
+                    background_compiler& compiler);
+    ~shader_reloader();
+
+    shader_reloader(shader_reloader const&) = delete;
+    shader_reloader& operator=(shader_reloader const&) = delete;
+
+    // the latest program that linked since the last call, if any
+    ::std::optional<reloaded_program> take();
+
+   private:
+    ::std::string path;
+    ::std::string vertex_source;
+    background_compiler& compiler;
+
+    int inotify = -1;
+    // watched directories by watch descriptor
+    ::std::map<int, ::std::string> directories;
+    // the shader and its includes as of the last rebuild
+    ::std::vector<::std::string> files;
+    // written to on destruction to wake the worker up
+    int wake[2] = {-1, -1};
+
+    ::std::mutex m;
+    // the latest rebuild, a newer one replaces it
+    program_sources sources;
+    ::std::future<build_result> building;
+
+    ::std::thread worker;
+
+    void run();
+    void rebuild();
+    // starts watching the files source was made of
+    void watch(::std::string const& source);
+  };
+
+}
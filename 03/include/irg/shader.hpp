@@ -5,8 +5,14 @@
 #include <streambuf>
 #include <cstring>
 #include <array>
+#include <algorithm>
+#include <vector>
 #include <memory>
+#include <utility>
+#include <optional>
+#include <unordered_map>
 #include <csignal>
+#include <cstdint>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -15,9 +21,19 @@
 
 #include <irg/common.hpp>
 #include <irg/ownership.hpp>
+#include <irg/preprocessor.hpp>
+#include <irg/program_cache.hpp>
+#include <irg/uniform_buffer.hpp>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
 
 namespace irg {
 
+  // name and value of every #define injected into a source
+  using defines = ::std::vector<::std::pair<::std::string, ::std::string>>;
+
   class shader {
     shared_ownership<unsigned> _id;
 
@@ -25,6 +41,26 @@ namespace irg {
     unsigned type;
 
     shader(char const* source, int const type)
+      : shader(source, type, nullptr) {}
+
+    // the compile log ends up in log instead of terminating
+    static ::std::optional<shader> try_compile(char const* source, 
+                                               int const type,
+                                               ::std::string& log) {
+      log.clear();
+      shader s{source, type, deferred{}};
+      if (!s.check(source, &log))
+        return ::std::nullopt;
+      return s;
+    }
+
+   private:
+    friend class shader_program;
+
+    struct deferred {};
+
+    // starts the compile without asking for its result, see check
+    shader(char const* source, int const type, deferred)
       : _id(deffer_ownership(
           new unsigned{glCreateShader(type)}, 
           [](auto* ptr) {
@@ -35,30 +71,84 @@ namespace irg {
     {
       glShaderSource(*_id, 1, &source, nullptr);
       glCompileShader(*_id);
+    }
+
+    shader(char const* source, int const type, ::std::string* error_log)
+      : shader(source, type, deferred{})
+    {
+      check(source, error_log);
+    }
 
+    // Waits for the compile, false with the log in error_log, if given,
+    // otherwise terminates. source is what was compiled.
+    bool check(char const* source, ::std::string* error_log) const {
       int success;
       ::std::array<char, 512> log;
 
       glGetShaderiv(*_id, GL_COMPILE_STATUS, &success);
       if (!success) {
-        glGetShaderInfoLog(*_id, log.max_size(), nullptr, log.data()),
+        glGetShaderInfoLog(*_id, log.max_size(), nullptr, log.data());
+        auto const remapped = remap_log(log.data(), source);
+        if (error_log) {
+          *error_log = remapped;
+          return false;
+        }
         ::std::cerr << "Error: " << "\n",
-        ::irg::terminate(log.data());
+        ::irg::terminate(remapped.c_str());
       }
+
+      return true;
     }
 
-    static shader from_file(char const* file, int const type) {
-      ::std::ifstream f(file);
-      if (!f.is_open())
-        ::std::cerr << "Error while opening file: ",
-        ::irg::terminate(file);
+    // true once check would not wait, needs GL_KHR_parallel_shader_compile
+    bool completed() const noexcept {
+      int done = 0;
+      glGetShaderiv(*_id, GL_COMPLETION_STATUS_KHR, &done);
+      return done;
+    }
 
-      ::std::string source(
-        (::std::istreambuf_iterator<char>(f)),
-        ::std::istreambuf_iterator<char>()
-      );
-      
-      return {source.c_str(), type};
+   public:
+
+    // Puts the defines right after the #version line, which has to come
+    // first. A #line directive keeps compiler messages on the lines of the
+    // original source.
+    static ::std::string inject_defines(::std::string source, 
+                                        defines const& d) {
+      if (d.empty())
+        return source;
+
+      ::std::string injected;
+      for (auto const& [name, value] : d)
+        injected += "#define " + name + " " + value + "\n";
+
+      auto const version = source.find("#version");
+      auto line_end = version == ::std::string::npos 
+        ? ::std::string::npos : source.find('\n', version);
+
+      if (line_end == ::std::string::npos)
+        return injected + "#line 1\n" + source;
+
+      // lines are counted from 1, the line after #version is its number + 1
+      auto const next_line = 2 + ::std::count(
+        source.begin(), source.begin() + line_end, '\n');
+      injected += "#line " + ::std::to_string(next_line) + "\n";
+
+      return source.insert(line_end + 1, injected);
+    }
+
+    // the file with its #include lines resolved, see preprocess
+    static ::std::string read_file(char const* file, defines const& d = {}) {
+      ::std::string error;
+      auto source = preprocess(file, error);
+      if (!source)
+        ::irg::terminate(error.c_str());
+
+      return inject_defines(::std::move(*source), d);
+    }
+
+    static shader from_file(char const* file, int const type,
+                            defines const& d = {}) {
+      return {read_file(file, d).c_str(), type};
     }
 
     unsigned id() const noexcept {
@@ -66,32 +156,387 @@ namespace irg {
     }
   };
 
+  // index into the uniform table of a shader_program, resolved once
+  struct uniform_handle {
+    int index = -1;
+
+    explicit operator bool() const noexcept {
+      return index >= 0;
+    }
+  };
+
+  struct uniform_info {
+    ::std::string name;
+    int location;
+    unsigned type;
+    int size;
+  };
+
+  // sources of a program that is only compiled if program_cache misses
+  struct program_sources {
+    ::std::string vertex;
+    ::std::string fragment;
+  };
+
   class shader_program {
     shared_ownership<unsigned> id;
 
-   public:
-    shader_program(shader const& vertex, shader const& fragment) 
-      : id(
-          deffer_ownership(
-            new unsigned{glCreateProgram()}, 
-            [](auto* ptr) {
-              glDeleteProgram(*ptr);
-            }
-          )
-        )
-    {
-      glAttachShader(*id, vertex.id());
-      glAttachShader(*id, fragment.id());
+    struct uniform_entry {
+      uniform_info info;
+      // last value uploaded through this program, big enough for a mat4
+      ::std::array<unsigned char, sizeof(float) * 16> value;
+      bool uploaded = false;
+    };
+
+    struct uniform_table {
+      ::std::vector<uniform_entry> entries;
+      ::std::unordered_map<::std::string, int> by_name;
+      // set by every upload that reached GL, see take_changes
+      bool changed = true;
+    };
+
+    shared_ownership<uniform_table> uniforms;
+
+    // enumerates active uniforms, arrays are reachable as "a" and "a[0]"
+    void reflect() {
+      int count = 0, max_length = 0;
+      glGetProgramiv(*id, GL_ACTIVE_UNIFORMS, &count);
+      glGetProgramiv(*id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+      ::std::string name(max_length, '\0');
+      for (int i = 0; i < count; ++i) {
+        int length = 0, size = 0;
+        unsigned type = 0;
+        glGetActiveUniform(*id, i, max_length, &length, &size, &type, 
+                           name.data());
+
+        ::std::string uniform_name{name.data(), 
+                                   static_cast<::std::size_t>(length)};
+        auto const location = glGetUniformLocation(*id, uniform_name.c_str());
+        // members of uniform blocks have no location
+        if (location < 0)
+          continue;
+
+        auto const index = static_cast<int>(uniforms->entries.size());
+        uniforms->entries.push_back({{uniform_name, location, type, size}, {}});
+        uniforms->by_name.emplace(uniform_name, index);
+
+        if (auto bracket = uniform_name.find('['); 
+            bracket != ::std::string::npos)
+          uniforms->by_name.emplace(uniform_name.substr(0, bracket), index);
+      }
+
+      for (auto const& block : uniform_block_bindings)
+        if (auto const index = glGetUniformBlockIndex(*id, block.name);
+            index != GL_INVALID_INDEX)
+          glUniformBlockBinding(*id, index, block.binding);
+    }
+
+    // stores the value, false if it matches what was last uploaded
+    bool cache(uniform_handle const u, void const* data, 
+               ::std::size_t const size) {
+      auto& entry = uniforms->entries[u.index];
+      if (entry.uploaded && !::std::memcmp(entry.value.data(), data, size))
+        return false;
+
+      ::std::memcpy(entry.value.data(), data, size);
+      entry.uploaded = true;
+      uniforms->changed = true;
+      return true;
+    }
+
+    int location(uniform_handle const u) const noexcept {
+      return uniforms->entries[u.index].info.location;
+    }
 
-      glLinkProgram(*id);
+    static shared_ownership<unsigned> create_program() {
+      return deffer_ownership(
+        new unsigned{glCreateProgram()}, 
+        [](auto* ptr) {
+          glDeleteProgram(*ptr);
+        }
+      );
+    }
+
+    // starts the link without asking for its result, see check_link
+    static void start_link(unsigned const program, shader const& vertex, 
+                           shader const& fragment) {
+      glAttachShader(program, vertex.id());
+      glAttachShader(program, fragment.id());
 
+      glLinkProgram(program);
+
+      glDetachShader(program, vertex.id());
+      glDetachShader(program, fragment.id());
+    }
+
+    // waits for the link, false with the log in error_log, if given,
+    // otherwise terminates
+    static bool check_link(unsigned const program, ::std::string* error_log) {
       int success;
       ::std::array<char, 512> log;
 
-      glGetProgramiv(*id, GL_LINK_STATUS, &success);
-      if (!success)
-        glGetProgramInfoLog(*id, log.max_size(), nullptr, log.data()),
+      glGetProgramiv(program, GL_LINK_STATUS, &success);
+      if (!success) {
+        glGetProgramInfoLog(program, log.max_size(), nullptr, log.data());
+        if (error_log) {
+          *error_log = log.data();
+          return false;
+        }
         ::irg::terminate(log.data());
+      }
+
+      return true;
+    }
+
+    // error_log as for check_link
+    bool link(shader const& vertex, shader const& fragment,
+              ::std::string* error_log) {
+      start_link(*id, vertex, fragment);
+      return check_link(*id, error_log);
+    }
+
+    // built, if given, tells whether the program is usable
+    shader_program(shader const& vertex, shader const& fragment,
+                   ::std::string* error_log, bool* built = nullptr)
+      : id(create_program())
+      , uniforms(::std::make_shared<uniform_table>())
+    {
+      auto const linked = link(vertex, fragment, error_log);
+      if (built)
+        *built = linked;
+      if (linked)
+        reflect();
+    }
+
+    shader_program(program_sources const& sources, ::std::string* error_log,
+                   bool* built = nullptr)
+      : id(create_program())
+      , uniforms(::std::make_shared<uniform_table>())
+    {
+      auto const key = program_cache::key(sources.vertex, sources.fragment);
+      if (built)
+        *built = false;
+
+      if (!program_cache::load(*id, key)) {
+        ::std::string log;
+        auto const vertex = shader::try_compile(
+          sources.vertex.c_str(), GL_VERTEX_SHADER, log);
+        auto const fragment = vertex 
+          ? shader::try_compile(
+              sources.fragment.c_str(), GL_FRAGMENT_SHADER, log)
+          : ::std::nullopt;
+
+        if (!fragment) {
+          if (error_log) {
+            *error_log = log;
+            return;
+          }
+          ::std::cerr << "Error: " << "\n",
+          ::irg::terminate(log.c_str());
+        }
+
+        program_cache::prepare(*id);
+        if (!link(*vertex, *fragment, error_log))
+          return;
+        program_cache::store(*id, key);
+      }
+
+      if (built)
+        *built = true;
+      reflect();
+    }
+
+    // takes over a program that linked
+    explicit shader_program(shared_ownership<unsigned> linked)
+      : id(::std::move(linked))
+      , uniforms(::std::make_shared<uniform_table>())
+    {
+      reflect();
+    }
+
+    // uploads a cached value to the location the entry has now
+    void upload(uniform_entry const& entry) {
+      auto const location = entry.info.location;
+      auto const* value   = entry.value.data();
+      float f[16];
+      int i;
+
+      switch (entry.info.type) {
+        case GL_FLOAT:
+          ::std::memcpy(f, value, sizeof(float));
+          glUniform1f(location, f[0]);
+          break;
+        case GL_FLOAT_VEC3:
+          ::std::memcpy(f, value, sizeof(float) * 3);
+          glUniform3fv(location, 1, f);
+          break;
+        case GL_FLOAT_MAT4:
+          ::std::memcpy(f, value, sizeof(float) * 16);
+          glUniformMatrix4fv(location, 1, GL_FALSE, f);
+          break;
+        default:
+          // ints, bools and samplers are all set through glUniform1i
+          ::std::memcpy(&i, value, sizeof(int));
+          glUniform1i(location, i);
+          break;
+      }
+    }
+
+   public:
+    shader_program(shader const& vertex, shader const& fragment) 
+      : shader_program(vertex, fragment, nullptr) {}
+
+    // links the binary program_cache has for the sources if there is one
+    explicit shader_program(program_sources const& sources)
+      : shader_program(sources, nullptr) {}
+
+    // the link log ends up in log instead of terminating
+    static ::std::optional<shader_program> try_link(shader const& vertex,
+                                                    shader const& fragment,
+                                                    ::std::string& log) {
+      log.clear();
+      bool built = false;
+      shader_program p{vertex, fragment, &log, &built};
+      if (!built)
+        return ::std::nullopt;
+      return p;
+    }
+
+    static ::std::optional<shader_program> try_build(
+        program_sources const& sources, ::std::string& log) {
+      log.clear();
+      bool built = false;
+      shader_program p{sources, &log, &built};
+      if (!built)
+        return ::std::nullopt;
+      return p;
+    }
+
+    // A build that runs while the caller goes on, see start_build. With
+    // GL_KHR_parallel_shader_compile the driver compiles and links on its
+    // own threads and ready tells when finish will not block. Without it
+    // only finish may be used, which then does all of the work.
+    class pending {
+     public:
+      // true once finish would not wait, needs the extension
+      bool ready() {
+        if (failed || !fragment)
+          return true;
+        if (!linking) {
+          if (!vertex->completed() || !fragment->completed())
+            return false;
+          link();
+        }
+
+        int done = 0;
+        glGetProgramiv(*id, GL_COMPLETION_STATUS_KHR, &done);
+        return failed || done;
+      }
+
+      // the program, or nothing with the compile or link errors in log
+      ::std::optional<shader_program> finish(::std::string& log) {
+        if (fragment && !linking)
+          link();
+
+        if (!failed && fragment && !check_link(*id, &this->log))
+          failed = true;
+        if (failed) {
+          log = this->log;
+          return ::std::nullopt;
+        }
+
+        if (fragment)
+          program_cache::store(*id, key);
+        return shader_program{id};
+      }
+
+     private:
+      friend class shader_program;
+
+      program_sources sources;
+      ::std::uint64_t key;
+      shared_ownership<unsigned> id;
+
+      // compiling, unless the program came from the cache
+      ::std::optional<shader> vertex;
+      ::std::optional<shader> fragment;
+      bool linking = false;
+
+      bool failed = false;
+      ::std::string log;
+
+      explicit pending(program_sources s)
+        : sources(::std::move(s))
+        , key(program_cache::key(sources.vertex, sources.fragment))
+        , id(create_program())
+      {
+        if (program_cache::load(*id, key))
+          return;
+
+        vertex = shader{
+          sources.vertex.c_str(), GL_VERTEX_SHADER, shader::deferred{}};
+        fragment = shader{
+          sources.fragment.c_str(), GL_FRAGMENT_SHADER, shader::deferred{}};
+      }
+
+      // waits for the compiles and starts the link if they succeeded
+      void link() {
+        linking = true;
+        if (!vertex->check(sources.vertex.c_str(), &log)
+            || !fragment->check(sources.fragment.c_str(), &log)) {
+          failed = true;
+          return;
+        }
+
+        program_cache::prepare(*id);
+        start_link(*id, *vertex, *fragment);
+      }
+    };
+
+    // Hands the sources to the driver and returns right away, the program
+    // cache is looked at first.
+    static pending start_build(program_sources sources) {
+      return pending{::std::move(sources)};
+    }
+
+    // Takes over next, a rebuild of this program from changed sources.
+    // Handles stay valid and every value set so far is uploaded to next.
+    // Copies of this program made earlier keep the old one.
+    void replace(shader_program const& next) {
+      auto table = ::std::make_shared<uniform_table>();
+
+      // old entries keep their index, vanished uniforms lose their location
+      for (auto entry : uniforms->entries) {
+        auto const found = next.uniforms->by_name.find(entry.info.name);
+        entry.info.location = found == next.uniforms->by_name.end() 
+          || next.uniforms->entries[found->second].info.type != entry.info.type
+            ? -1
+            : next.uniforms->entries[found->second].info.location;
+        table->entries.push_back(entry);
+      }
+      table->by_name = uniforms->by_name;
+
+      for (auto const& entry : next.uniforms->entries) {
+        auto const& name = entry.info.name;
+        if (table->by_name.count(name))
+          continue;
+
+        auto const index = static_cast<int>(table->entries.size());
+        table->entries.push_back(entry);
+        table->by_name.emplace(name, index);
+        if (auto bracket = name.find('['); bracket != ::std::string::npos)
+          table->by_name.emplace(name.substr(0, bracket), index);
+      }
+
+      id       = next.id;
+      uniforms = ::std::move(table);
+
+      activate();
+      for (auto const& entry : uniforms->entries)
+        if (entry.uploaded && entry.info.location >= 0)
+          upload(entry);
+      uniforms->changed = true;
     }
 
     shader_program& activate() noexcept {
@@ -102,33 +547,73 @@ namespace irg {
     shader_program* operator->() noexcept {
       return &activate();
     }
-    
+
+    // invalid handle if the uniform is not active, setters ignore those
+    uniform_handle uniform(char const* uniform_name) const {
+      auto const iter = uniforms->by_name.find(uniform_name);
+      return {iter == uniforms->by_name.end() ? -1 : iter->second};
+    }
+
+    uniform_info const& info(uniform_handle const u) const noexcept {
+      return uniforms->entries[u.index].info;
+    }
+
+    // whether any uniform changed since the last call, i.e. the image is stale
+    bool take_changes() noexcept {
+      return ::std::exchange(uniforms->changed, false);
+    }
+
+    ::std::vector<uniform_info> active_uniforms() const {
+      ::std::vector<uniform_info> ret;
+      for (auto const& entry : uniforms->entries)
+        ret.push_back(entry.info);
+      return ret;
+    }
+
+    void set_uniform_float(uniform_handle const u, float const f) {
+      if (u && cache(u, &f, sizeof(f)))
+        glUniform1f(location(u), f);
+    }
+
     void set_uniform_float(char const* uniform_name, float const f) {
-      glUniform1f(glGetUniformLocation(*id, uniform_name), f);
+      set_uniform_float(uniform(uniform_name), f);
     }
     
     void transform_uniform_float(char const* uniform_name,
                                  ::std::function<float(float)> transform) {
-      auto location = glGetUniformLocation(*id, uniform_name);
+      auto const u = uniform(uniform_name);
+      if (!u)
+        return;
+
       float val;
-      glGetUniformfv(*id, location, &val);
-      glUniform1f(location, transform(val));
+      if (auto const& entry = uniforms->entries[u.index]; entry.uploaded)
+        ::std::memcpy(&val, entry.value.data(), sizeof(val));
+      else
+        glGetUniformfv(*id, location(u), &val);
+
+      set_uniform_float(u, transform(val));
+    }
+
+    void set_uniform_int(uniform_handle const u, int const i) {
+      if (u && cache(u, &i, sizeof(i)))
+        glUniform1i(location(u), i);
     }
-    
 
     void set_uniform_int(char const* uniform_name, int const i) {
-      glUniform1i(glGetUniformLocation(*id, uniform_name), i);
+      set_uniform_int(uniform(uniform_name), i);
     }
 
     void set_uniform_color(char const* uniform_name, ::glm::vec3 const& c) {
-      glUniform3f(glGetUniformLocation(*id, uniform_name), c.r, c.g, c.b);
+      set_uniform_vec3(uniform(uniform_name), c);
+    }
+
+    void set_uniform_vec3(uniform_handle const u, ::glm::vec3 const &v) {
+      if (u && cache(u, ::glm::value_ptr(v), sizeof(float) * 3))
+        glUniform3fv(location(u), 1, ::glm::value_ptr(v));
     }
 
     void set_uniform_vec3(char const* uniform_name, ::glm::vec3 const &v) {
-      glUniform3fv(
-        glGetUniformLocation(*id, uniform_name), 
-        1, ::glm::value_ptr(v)
-      );
+      set_uniform_vec3(uniform(uniform_name), v);
     }
 
     ::glm::mat4 get_uniform_matrix(char const* uniform_name) {
@@ -138,11 +623,13 @@ namespace irg {
       return ::glm::make_mat4(mat.get());
     }
 
+    void set_uniform_matrix(uniform_handle const u, ::glm::mat4 const& m) {
+      if (u && cache(u, ::glm::value_ptr(m), sizeof(float) * 16))
+        glUniformMatrix4fv(location(u), 1, GL_FALSE, ::glm::value_ptr(m));
+    }
+
     void set_uniform_matrix(char const* uniform_name, ::glm::mat4 const& m) {
-      glUniformMatrix4fv(
-        glGetUniformLocation(*id, uniform_name), 
-        1, GL_FALSE, ::glm::value_ptr(m)
-      );
+      set_uniform_matrix(uniform(uniform_name), m);
     }
 
     void transform_matrix(char const* uniform_name, ::glm::mat4 const& m) {
@@ -0,0 +1,441 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// 8-wide float packets for the CPU ray marcher. With AVX2 available each
+// packet is a single ymm register and the transcendentals are cephes-style
+// polynomial approximations; otherwise the same interface is backed by plain
+// arrays and the standard library, which keeps the marcher portable.
+
+namespace irg::simd {
+
+  constexpr int width = 8;
+
+#ifdef __AVX2__
+
+  struct f8 {
+    __m256 v;
+
+    f8() noexcept : v(_mm256_setzero_ps()) {}
+    f8(float const f) noexcept : v(_mm256_set1_ps(f)) {}
+    f8(__m256 const v) noexcept : v(v) {}
+
+    static f8 load(float const* p) noexcept { return _mm256_loadu_ps(p); }
+    void store(float* p) const noexcept { _mm256_storeu_ps(p, v); }
+  };
+
+  struct m8 {
+    __m256 v;
+
+    m8(__m256 const v) noexcept : v(v) {}
+
+    static m8 all() noexcept {
+      return _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    }
+
+    int bits() const noexcept { return _mm256_movemask_ps(v); }
+    bool any() const noexcept { return bits() != 0; }
+    bool none() const noexcept { return bits() == 0; }
+  };
+
+  inline f8 operator+(f8 a, f8 b) noexcept { return _mm256_add_ps(a.v, b.v); }
+  inline f8 operator-(f8 a, f8 b) noexcept { return _mm256_sub_ps(a.v, b.v); }
+  inline f8 operator*(f8 a, f8 b) noexcept { return _mm256_mul_ps(a.v, b.v); }
+  inline f8 operator/(f8 a, f8 b) noexcept { return _mm256_div_ps(a.v, b.v); }
+  inline f8 operator-(f8 a) noexcept {
+    return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f));
+  }
+
+  inline m8 operator<(f8 a, f8 b) noexcept {
+    return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ);
+  }
+  inline m8 operator<=(f8 a, f8 b) noexcept {
+    return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ);
+  }
+  inline m8 operator>(f8 a, f8 b) noexcept {
+    return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ);
+  }
+  inline m8 operator>=(f8 a, f8 b) noexcept {
+    return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ);
+  }
+
+  inline m8 operator==(f8 a, f8 b) noexcept {
+    return _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ);
+  }
+
+  inline m8 operator&(m8 a, m8 b) noexcept { return _mm256_and_ps(a.v, b.v); }
+  inline m8 operator|(m8 a, m8 b) noexcept { return _mm256_or_ps(a.v, b.v); }
+  inline m8 andnot(m8 a, m8 b) noexcept { return _mm256_andnot_ps(b.v, a.v); }
+
+  // picks a where the mask is set, b otherwise
+  inline f8 select(m8 m, f8 a, f8 b) noexcept {
+    return _mm256_blendv_ps(b.v, a.v, m.v);
+  }
+
+  inline f8 fma(f8 a, f8 b, f8 c) noexcept {
+#ifdef __FMA__
+    return _mm256_fmadd_ps(a.v, b.v, c.v);
+#else
+    return a * b + c;
+#endif
+  }
+
+  inline f8 min(f8 a, f8 b) noexcept { return _mm256_min_ps(a.v, b.v); }
+  inline f8 max(f8 a, f8 b) noexcept { return _mm256_max_ps(a.v, b.v); }
+  inline f8 sqrt(f8 a) noexcept { return _mm256_sqrt_ps(a.v); }
+  inline f8 floor(f8 a) noexcept { return _mm256_floor_ps(a.v); }
+  inline f8 abs(f8 a) noexcept {
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v);
+  }
+  inline f8 sign_of(f8 a) noexcept {
+    return _mm256_and_ps(_mm256_set1_ps(-0.0f), a.v);
+  }
+  inline f8 copysign(f8 magnitude, f8 sign) noexcept {
+    return _mm256_or_ps(abs(magnitude).v, sign_of(sign).v);
+  }
+
+  inline f8 log(f8 x) noexcept {
+    auto const i   = _mm256_castps_si256(x.v);
+    auto       e   = _mm256_sub_epi32(_mm256_srli_epi32(i, 23),
+                                      _mm256_set1_epi32(126));
+    f8         m   = _mm256_castsi256_ps(
+      _mm256_or_si256(
+        _mm256_and_si256(i, _mm256_set1_epi32(0x007fffff)),
+        _mm256_set1_epi32(0x3f000000)
+      )
+    );
+    f8 ef = _mm256_cvtepi32_ps(e);
+
+    // m in [0.5, 1), shift it to [sqrt(1/2), sqrt(2))
+    m8 const small = m < f8{0.707106781186547524f};
+    ef = ef - select(small, 1.0f, 0.0f);
+    m  = m + select(small, m, 0.0f) - 1.0f;
+
+    f8 const z = m * m;
+    f8 y = 7.0376836292e-2f;
+    y = fma(y, m, -1.1514610310e-1f);
+    y = fma(y, m,  1.1676998740e-1f);
+    y = fma(y, m, -1.2420140846e-1f);
+    y = fma(y, m,  1.4249322787e-1f);
+    y = fma(y, m, -1.6668057665e-1f);
+    y = fma(y, m,  2.0000714765e-1f);
+    y = fma(y, m, -2.4999993993e-1f);
+    y = fma(y, m,  3.3333331174e-1f);
+    y = y * m * z;
+    y = fma(ef, -2.12194440e-4f, y);
+    y = fma(z, -0.5f, y);
+
+    f8 const r = fma(ef, 0.693359375f, m + y);
+    return select(x > 0.0f, r, select(x == 0.0f, -HUGE_VALF, NAN));
+  }
+
+  inline f8 exp(f8 x) noexcept {
+    x = min(max(x, -87.3f), 88.3f);
+
+    f8 const n = floor(fma(x, 1.44269504088896341f, 0.5f));
+    x = fma(n, -0.693359375f, x);
+    x = fma(n, 2.12194440e-4f, x);
+
+    f8 y = 1.9875691500e-4f;
+    y = fma(y, x, 1.3981999507e-3f);
+    y = fma(y, x, 8.3334519073e-3f);
+    y = fma(y, x, 4.1665795894e-2f);
+    y = fma(y, x, 1.6666665459e-1f);
+    y = fma(y, x, 5.0000001201e-1f);
+    y = fma(y, x * x, x + 1.0f);
+
+    auto const pow2n = _mm256_slli_epi32(
+      _mm256_add_epi32(_mm256_cvtps_epi32(n.v), _mm256_set1_epi32(127)), 23
+    );
+    return y * f8{_mm256_castsi256_ps(pow2n)};
+  }
+
+  // x^y for x >= 0, the only case the distance estimators need
+  inline f8 pow(f8 x, f8 y) noexcept {
+    return select(x > 0.0f, exp(y * log(x)), 0.0f);
+  }
+
+  namespace detail {
+
+    // reduces x to [-pi/4, pi/4], returning the octant in q
+    inline f8 reduce_quadrant(f8 x, __m256i& q) noexcept {
+      auto ji = _mm256_cvttps_epi32((abs(x) * 1.27323954473516f).v);
+      // make the octant even
+      ji = _mm256_and_si256(
+        _mm256_add_epi32(ji, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1)
+      );
+      f8 const j = _mm256_cvtepi32_ps(ji);
+
+      f8 y = abs(x);
+      y = fma(j, -0.78515625f, y);
+      y = fma(j, -2.4187564849853515625e-4f, y);
+      y = fma(j, -3.77489497744594108e-8f, y);
+
+      q = ji;
+      return y;
+    }
+
+    inline f8 sin_poly(f8 x) noexcept {
+      f8 const z = x * x;
+      f8 y = -1.9515295891e-4f;
+      y = fma(y, z,  8.3321608736e-3f);
+      y = fma(y, z, -1.6666654611e-1f);
+      return fma(y * z, x, x);
+    }
+
+    inline f8 cos_poly(f8 x) noexcept {
+      f8 const z = x * x;
+      f8 y = 2.443315711809948e-5f;
+      y = fma(y, z, -1.388731625493765e-3f);
+      y = fma(y, z,  4.166664568298827e-2f);
+      return fma(y * z, z, fma(z, -0.5f, 1.0f));
+    }
+
+    inline m8 lane_mask(__m256i const i) noexcept {
+      return _mm256_castsi256_ps(_mm256_cmpeq_epi32(i, _mm256_set1_epi32(0)));
+    }
+
+  }
+
+  inline void sincos(f8 x, f8& s, f8& c) noexcept {
+    __m256i q;
+    f8 const y  = detail::reduce_quadrant(x, q);
+    f8 const ps = detail::sin_poly(y);
+    f8 const pc = detail::cos_poly(y);
+
+    // odd quarter turns swap the polynomials, the rest is sign bookkeeping
+    m8 const poly = detail::lane_mask(
+      _mm256_and_si256(q, _mm256_set1_epi32(2)));
+
+    auto const sin_sign = _mm256_xor_ps(
+      sign_of(x).v,
+      _mm256_castsi256_ps(_mm256_slli_epi32(
+        _mm256_and_si256(q, _mm256_set1_epi32(4)), 29))
+    );
+    auto const cos_sign = _mm256_castsi256_ps(_mm256_slli_epi32(
+      _mm256_andnot_si256(
+        _mm256_sub_epi32(q, _mm256_set1_epi32(2)), _mm256_set1_epi32(4)),
+      29
+    ));
+
+    s = _mm256_xor_ps(select(poly, ps, pc).v, sin_sign);
+    c = _mm256_xor_ps(select(poly, pc, ps).v, cos_sign);
+  }
+
+  inline f8 atan(f8 x) noexcept {
+    f8 const sign = sign_of(x);
+    x = abs(x);
+
+    // reduce to [0, tan(pi/8)]
+    m8 const big    = x > 2.414213562373095f;
+    m8 const middle = andnot(x > 0.4142135623730950f, big);
+
+    f8 const base = select(big, 1.57079632679489661923f,
+                      select(middle, 0.78539816339744830962f, 0.0f));
+    x = select(big, -1.0f / x, select(middle, (x - 1.0f) / (x + 1.0f), x));
+
+    f8 const z = x * x;
+    f8 y = 8.05374449538e-2f;
+    y = fma(y, z, -1.38776856032e-1f);
+    y = fma(y, z,  1.99777106478e-1f);
+    y = fma(y, z, -3.33329491539e-1f);
+    y = fma(y * z, x, x) + base;
+
+    return _mm256_xor_ps(y.v, sign.v);
+  }
+
+  inline f8 atan2(f8 y, f8 x) noexcept {
+    f8 r = atan(y / x);
+    f8 const pi = 3.14159265358979323846f;
+    r = select(x < 0.0f, r + copysign(pi, y), r);
+    // atan(+-inf) resolves x == 0 on its own, 0 / 0 does not
+    return select((x == 0.0f) & (y == 0.0f), 0.0f, r);
+  }
+
+  inline f8 acos(f8 x) noexcept {
+    x = min(max(x, -1.0f), 1.0f);
+    return atan2(sqrt(1.0f - x * x), x);
+  }
+
+#else
+
+  struct f8 {
+    float v[width];
+
+    f8() noexcept : v{} {}
+    f8(float const f) noexcept { for (auto& e : v) e = f; }
+
+    static f8 load(float const* p) noexcept {
+      f8 r;
+      for (int i = 0; i < width; ++i) r.v[i] = p[i];
+      return r;
+    }
+    void store(float* p) const noexcept {
+      for (int i = 0; i < width; ++i) p[i] = v[i];
+    }
+  };
+
+  struct m8 {
+    bool v[width];
+
+    static m8 all() noexcept {
+      m8 r;
+      for (auto& e : r.v) e = true;
+      return r;
+    }
+
+    int bits() const noexcept {
+      int r = 0;
+      for (int i = 0; i < width; ++i) r |= v[i] << i;
+      return r;
+    }
+    bool any() const noexcept { return bits() != 0; }
+    bool none() const noexcept { return bits() == 0; }
+  };
+
+  namespace detail {
+    template<typename F>
+    f8 map(F&& f, f8 const& a) noexcept {
+      f8 r;
+      for (int i = 0; i < width; ++i) r.v[i] = f(a.v[i]);
+      return r;
+    }
+
+    template<typename F>
+    f8 map(F&& f, f8 const& a, f8 const& b) noexcept {
+      f8 r;
+      for (int i = 0; i < width; ++i) r.v[i] = f(a.v[i], b.v[i]);
+      return r;
+    }
+
+    template<typename F>
+    m8 test(F&& f, f8 const& a, f8 const& b) noexcept {
+      m8 r;
+      for (int i = 0; i < width; ++i) r.v[i] = f(a.v[i], b.v[i]);
+      return r;
+    }
+  }
+
+  inline f8 operator+(f8 a, f8 b) noexcept {
+    return detail::map([](float x, float y) { return x + y; }, a, b);
+  }
+  inline f8 operator-(f8 a, f8 b) noexcept {
+    return detail::map([](float x, float y) { return x - y; }, a, b);
+  }
+  inline f8 operator*(f8 a, f8 b) noexcept {
+    return detail::map([](float x, float y) { return x * y; }, a, b);
+  }
+  inline f8 operator/(f8 a, f8 b) noexcept {
+    return detail::map([](float x, float y) { return x / y; }, a, b);
+  }
+  inline f8 operator-(f8 a) noexcept {
+    return detail::map([](float x) { return -x; }, a);
+  }
+
+  inline m8 operator<(f8 a, f8 b) noexcept {
+    return detail::test([](float x, float y) { return x < y; }, a, b);
+  }
+  inline m8 operator<=(f8 a, f8 b) noexcept {
+    return detail::test([](float x, float y) { return x <= y; }, a, b);
+  }
+  inline m8 operator>(f8 a, f8 b) noexcept {
+    return detail::test([](float x, float y) { return x > y; }, a, b);
+  }
+  inline m8 operator>=(f8 a, f8 b) noexcept {
+    return detail::test([](float x, float y) { return x >= y; }, a, b);
+  }
+
+  inline m8 operator==(f8 a, f8 b) noexcept {
+    return detail::test([](float x, float y) { return x == y; }, a, b);
+  }
+
+  inline m8 operator&(m8 a, m8 b) noexcept {
+    for (int i = 0; i < width; ++i) a.v[i] = a.v[i] && b.v[i];
+    return a;
+  }
+  inline m8 operator|(m8 a, m8 b) noexcept {
+    for (int i = 0; i < width; ++i) a.v[i] = a.v[i] || b.v[i];
+    return a;
+  }
+  inline m8 andnot(m8 a, m8 b) noexcept {
+    for (int i = 0; i < width; ++i) a.v[i] = a.v[i] && !b.v[i];
+    return a;
+  }
+
+  inline f8 select(m8 m, f8 a, f8 b) noexcept {
+    for (int i = 0; i < width; ++i) if (m.v[i]) b.v[i] = a.v[i];
+    return b;
+  }
+
+  inline f8 fma(f8 a, f8 b, f8 c) noexcept { return a * b + c; }
+
+  inline f8 min(f8 a, f8 b) noexcept {
+    return detail::map([](float x, float y) { return ::std::fmin(x, y); }, a, b);
+  }
+  inline f8 max(f8 a, f8 b) noexcept {
+    return detail::map([](float x, float y) { return ::std::fmax(x, y); }, a, b);
+  }
+  inline f8 sqrt(f8 a) noexcept {
+    return detail::map([](float x) { return ::std::sqrt(x); }, a);
+  }
+  inline f8 floor(f8 a) noexcept {
+    return detail::map([](float x) { return ::std::floor(x); }, a);
+  }
+  inline f8 abs(f8 a) noexcept {
+    return detail::map([](float x) { return ::std::fabs(x); }, a);
+  }
+  inline f8 log(f8 a) noexcept {
+    return detail::map([](float x) { return ::std::log(x); }, a);
+  }
+  inline f8 exp(f8 a) noexcept {
+    return detail::map([](float x) { return ::std::exp(x); }, a);
+  }
+  inline f8 pow(f8 a, f8 b) noexcept {
+    return detail::map([](float x, float y) { return ::std::pow(x, y); }, a, b);
+  }
+  inline void sincos(f8 x, f8& s, f8& c) noexcept {
+    s = detail::map([](float a) { return ::std::sin(a); }, x);
+    c = detail::map([](float a) { return ::std::cos(a); }, x);
+  }
+  inline f8 atan2(f8 y, f8 x) noexcept {
+    return detail::map([](float a, float b) { return ::std::atan2(a, b); }, y, x);
+  }
+  inline f8 acos(f8 a) noexcept {
+    return detail::map([](float x) {
+      return ::std::acos(::std::fmin(1.0f, ::std::fmax(-1.0f, x)));
+    }, a);
+  }
+
+#endif
+
+  // structure of arrays vector, one ray component per packet
+  struct v3 {
+    f8 x, y, z;
+  };
+
+  inline v3 operator+(v3 const& a, v3 const& b) noexcept {
+    return {a.x + b.x, a.y + b.y, a.z + b.z};
+  }
+  inline v3 operator-(v3 const& a, v3 const& b) noexcept {
+    return {a.x - b.x, a.y - b.y, a.z - b.z};
+  }
+  inline v3 operator*(v3 const& a, f8 const& s) noexcept {
+    return {a.x * s, a.y * s, a.z * s};
+  }
+
+  inline f8 dot(v3 const& a, v3 const& b) noexcept {
+    return fma(a.x, b.x, fma(a.y, b.y, a.z * b.z));
+  }
+  inline f8 length(v3 const& a) noexcept {
+    return sqrt(dot(a, a));
+  }
+  inline v3 select(m8 m, v3 const& a, v3 const& b) noexcept {
+    return {select(m, a.x, b.x), select(m, a.y, b.y), select(m, a.z, b.z)};
+  }
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <functional>
+#include <condition_variable>
+
+namespace irg {
+
+  // Fixed size pool where every worker owns a deque. Workers take their own
+  // work LIFO and steal from the other end of someone else's deque when they
+  // run dry, so uneven tiles (a screen full of background next to a tile full
+  // of Mandelbulb) do not leave cores idle.
+  class thread_pool {
+   public:
+    using task = ::std::function<void(void)>;
+
+    explicit thread_pool(unsigned const threads =
+                           ::std::thread::hardware_concurrency());
+    ~thread_pool();
+
+    thread_pool(thread_pool const&) = delete;
+    thread_pool& operator=(thread_pool const&) = delete;
+
+    void submit(task t);
+
+    // blocks until every submitted task has finished
+    void wait_idle();
+
+    // runs f(i) for i in [0, count) and waits for all of them
+    void parallel_for(::std::size_t const count,
+                      ::std::function<void(::std::size_t)> const& f);
+
+    unsigned size() const noexcept {
+      return static_cast<unsigned>(workers.size());
+    }
+
+   private:
+    struct queue {
+      ::std::mutex m;
+      ::std::deque<task> tasks;
+    };
+
+    ::std::vector<::std::unique_ptr<queue>> queues;
+    ::std::vector<::std::thread> workers;
+
+    ::std::mutex m;
+    ::std::condition_variable work_available;
+    ::std::condition_variable idle;
+
+    ::std::size_t queued     = 0;
+    ::std::size_t unfinished = 0;
+    bool stopping = false;
+
+    ::std::atomic<unsigned> next_queue{0};
+
+    bool try_take(unsigned const self, task& t);
+    void run(unsigned const self);
+  };
+
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <map>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <optional>
+
+#include <glm/glm.hpp>
+
+namespace irg {
+
+  // how a track moves from a key to the next one
+  enum class interpolation {
+    linear,
+    // cubic through the out handle of the key and the in handle of the next
+    bezier,
+    // smooth through the neighbouring keys, no handles needed
+    catmull_rom,
+  };
+
+  struct keyframe {
+    double time = 0.0;
+    ::glm::vec3 value = {0.0, 0.0, 0.0};
+    // bezier control points, the value itself if not given
+    ::glm::vec3 in  = {0.0, 0.0, 0.0};
+    ::glm::vec3 out = {0.0, 0.0, 0.0};
+    // of the segment up to the next key
+    interpolation mode = interpolation::linear;
+  };
+
+  // Keys of a scalar (the x component) or vec3 parameter, sorted by time.
+  // Before the first and after the last key the track holds its value.
+  struct track {
+    int components = 1;
+    ::std::vector<keyframe> keys;
+
+    ::glm::vec3 sample(double const t) const noexcept;
+  };
+
+  // Keyframed tracks of named parameters: camera.position, camera.target,
+  // camera.fov (degrees), the fractal parameters, or any other uniform of
+  // the shaders.
+  class timeline {
+   public:
+    // repeats once the last key of every track is reached
+    bool loop = false;
+    ::std::map<::std::string, track> tracks;
+
+    // time of the last key
+    double duration() const noexcept;
+
+    bool has(::std::string const& name) const {
+      return tracks.count(name) != 0;
+    }
+
+    // leave value untouched if there is no such track
+    void sample(::std::string const& name, double const t, float& value) const;
+    void sample(::std::string const& name, double const t,
+                ::glm::vec3& value) const;
+
+   private:
+    double wrap(double const t) const noexcept;
+  };
+
+  // Reads a timeline, one key per line:
+  //
+  //   <track> <time> <linear|bezier|catmull_rom> <value>...
+  //     [in <value>...] [out <value>...]
+  //
+  // with 1 or 3 values per key, the same for every key of a track. Lines
+  // holding just "loop" make the timeline repeat, # starts a comment.
+  // Returns nothing and explains why in error if the file is malformed.
+  ::std::optional<timeline> load_timeline(::std::string const& path,
+                                          ::std::string& error);
+
+  // Time animations are sampled at. Follows the wall clock, or advances by
+  // a fixed step per frame so offline renders come out the same every run.
+  class timeline_clock {
+   public:
+    // step in seconds, 0 for the wall clock
+    explicit timeline_clock(double const step = 0.0) noexcept
+      : step(step) {}
+
+    // advances to the frame about to be rendered and returns its time, the
+    // first tick is at 0
+    double tick() noexcept;
+
+    // back to before the first tick
+    void restart() noexcept {
+      current = 0.0;
+      started = false;
+    }
+
+    double now() const noexcept {
+      return current;
+    }
+
+    bool fixed() const noexcept {
+      return step > 0.0;
+    }
+
+   private:
+    using clock = ::std::chrono::steady_clock;
+
+    double step;
+    clock::time_point start;
+    double current = 0.0;
+    bool started = false;
+  };
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <deque>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+
+#include <glm/glm.hpp>
+
+namespace irg {
+
+  // what a frame was rendered with, recorded next to its timings
+  struct frame_parameters {
+    int width  = 0;
+    int height = 0;
+    int iterations     = 0;
+    int max_steps      = 0;
+    float min_distance = 0.0;
+    // 0 if min_distance is the hit threshold
+    float hit_footprint = 0.0;
+    float power        = 0.0;
+    ::glm::vec3 camera_position = {0.0, 0.0, 0.0};
+    ::glm::vec3 camera_target   = {0.0, 0.0, 0.0};
+  };
+
+  struct frame_sample {
+    ::std::uint64_t frame = 0;
+    double cpu_ms = 0.0;
+    // negative if the frame had no free timer query
+    double gpu_ms = -1.0;
+    frame_parameters parameters;
+  };
+
+  struct percentiles {
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+  };
+
+  // Times frames on the CPU and, with GL_TIME_ELAPSED queries, on the GPU.
+  // Queries are kept in a ring and only read back once available, so the
+  // timer never waits for the GPU, results simply arrive a few frames late.
+  // Only one frame can be timed at a time, queries do not nest.
+  class frame_timer {
+   public:
+    // last window frames are kept for the rolling percentiles
+    explicit frame_timer(::std::size_t const window = 240,
+                         ::std::size_t const query_count = 8);
+    ~frame_timer();
+
+    frame_timer(frame_timer const&) = delete;
+    frame_timer& operator=(frame_timer const&) = delete;
+
+    // streams a row per frame, false if the file could not be opened
+    bool open_csv(char const* path);
+
+    void begin();
+    void end(frame_parameters const& parameters);
+
+    // blocks until every pending query has its result
+    void flush();
+
+    // frames completed since the timer was made, including GPU time
+    ::std::uint64_t completed() const noexcept {
+      return recorded;
+    }
+
+    percentiles cpu() const;
+    // zero if no frame had a GPU time yet
+    percentiles gpu() const;
+
+    void print_summary(::std::ostream& out) const;
+
+   private:
+    using clock = ::std::chrono::steady_clock;
+
+    // finished frames, in order, waiting for their query if they have one
+    struct pending_frame {
+      frame_sample sample;
+      ::std::size_t slot;
+    };
+
+    ::std::size_t window;
+    ::std::vector<unsigned> queries;
+    ::std::vector<bool> busy;
+    ::std::size_t next_slot = 0;
+    // slot of the frame in progress, or queries.size() if it is not GPU timed
+    ::std::size_t current;
+    ::std::deque<pending_frame> pending;
+
+    clock::time_point frame_start;
+    ::std::uint64_t frames   = 0;
+    ::std::uint64_t recorded = 0;
+
+    ::std::deque<double> cpu_times;
+    ::std::deque<double> gpu_times;
+
+    ::std::unique_ptr<::std::FILE, int(*)(::std::FILE*)> csv{nullptr, nullptr};
+
+    // collects finished queries in frame order, waiting on them if asked to
+    void poll(bool const wait);
+    void record(frame_sample const& s);
+  };
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <irg/ownership.hpp>
+
+namespace irg {
+
+  // Binding points of the uniform blocks shared between programs. Every
+  // shader_program binds its blocks of these names once it is linked, GLSL
+  // 3.30 has no layout (binding = n).
+  struct uniform_block_binding {
+    char const* name;
+    unsigned binding;
+  };
+
+  inline constexpr uniform_block_binding uniform_block_bindings[] = {
+    {"frame_uniforms", 0},
+  };
+
+  // Per frame parameters of the fractals, the std140 block frame_uniforms
+  // of data/shaders/lib/common.glsl. Programs specialized for a parameter
+  // ignore its member.
+  struct frame_uniforms {
+    static unsigned constexpr binding = 0;
+
+    ::glm::mat4 camera{1.0f};
+    ::glm::mat4 previous_camera{1.0f};
+    ::glm::vec3 resolution{0.0f, 0.0f, 0.0f};
+    float power = 0.0f;
+    int iterations = 0;
+    int max_steps = 0;
+    float min_distance = 0.0f;
+    float hit_footprint = 0.0f;
+    float relaxation = 1.0f;
+    // std140 rounds the block up to a multiple of a vec4
+    float padding[3] = {};
+  };
+
+  static_assert(offsetof(frame_uniforms, previous_camera) == 64);
+  static_assert(offsetof(frame_uniforms, resolution) == 128);
+  static_assert(offsetof(frame_uniforms, power) == 140);
+  static_assert(offsetof(frame_uniforms, relaxation) == 160);
+  static_assert(sizeof(frame_uniforms) == 176);
+
+  // Buffer behind a uniform block, bound to its binding point for good.
+  // Uploads are skipped while the value does not change.
+  template<typename T>
+  class uniform_buffer {
+    static_assert(::std::is_trivially_copyable_v<T>);
+
+    shared_ownership<unsigned> buffer;
+    T uploaded;
+    bool empty = true;
+
+   public:
+    explicit uniform_buffer(unsigned const binding)
+      : buffer(deffer_ownership(
+          new unsigned{0},
+          [](auto* ptr) {
+            glDeleteBuffers(1, ptr);
+          }
+        ))
+    {
+      glGenBuffers(1, buffer.get());
+      glBindBuffer(GL_UNIFORM_BUFFER, *buffer);
+      glBufferData(GL_UNIFORM_BUFFER, sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+      glBindBufferBase(GL_UNIFORM_BUFFER, binding, *buffer);
+    }
+
+    // whether value differs from what the buffer holds
+    bool differs(T const& value) const noexcept {
+      return empty || ::std::memcmp(&uploaded, &value, sizeof(T));
+    }
+
+    void upload(T const& value) {
+      if (!differs(value))
+        return;
+
+      glBindBuffer(GL_UNIFORM_BUFFER, *buffer);
+      glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &value);
+      uploaded = value;
+      empty = false;
+    }
+
+    unsigned id() const noexcept {
+      return *buffer;
+    }
+  };
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <map>
+#include <list>
+#include <future>
+#include <string>
+#include <cstddef>
+#include <optional>
+
+#include <irg/shader.hpp>
+#include <irg/compiler.hpp>
+
+namespace irg {
+
+  // GLSL literal of a float that parses back to exactly the same value
+  ::std::string glsl_float(float const f);
+
+  // Programs specialized by defines injected into the fragment source of a
+  // generic program, so the compiler can unroll loops and fold constants.
+  // Recently used variants are kept, variants that are still building are
+  // stood in for by the generic program.
+  class program_variants {
+   public:
+    // variants kept besides the generic program
+    ::std::size_t capacity = 8;
+
+    program_variants(program_sources generic_sources,
+                     shader_program const& generic,
+                     background_compiler& compiler);
+
+    // starts over from a new generic program, e.g. after a reload
+    void reset(program_sources generic_sources,
+               shader_program const& generic);
+
+    // program was pointed at another program, the next request points it
+    // back at a variant of this one
+    void restart() noexcept {
+      current.clear();
+      started = false;
+    }
+
+    // Points program at the variant for d, or at the generic program while
+    // that one is built. Cheap if d did not change since the last call.
+    void request(shader_program& program, defines const& d);
+
+    // collects finished builds, switches program over if the requested
+    // variant is among them
+    void poll(shader_program& program);
+
+   private:
+    struct variant {
+      ::std::string key;
+      shader_program program;
+    };
+
+    background_compiler& compiler;
+
+    program_sources generic_sources;
+    ::std::optional<shader_program> generic;
+
+    // most recently used first
+    ::std::list<variant> variants;
+    ::std::map<::std::string, ::std::future<build_result>> building;
+
+    ::std::string requested;
+    // key of the program the caller draws with, empty for the generic one
+    ::std::string current;
+    bool started = false;
+
+    void use(shader_program& program, ::std::string const& key);
+  };
+
+}
@@ -0,0 +1,356 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+
+#include <irg/common.hpp>
+#include <irg/shader.hpp>
+#include <irg/camera.hpp>
+#include <irg/timing.hpp>
+#include <irg/headless.hpp>
+#include <irg/timeline.hpp>
+#include <irg/framebuffer.hpp>
+#include <irg/march_cost.hpp>
+#include <irg/uniform_buffer.hpp>
+
+// Replays fixed camera flights through the shaders of data/shaders and
+// prints one CSV row per run, so builds and optimization modes can be
+// compared. Rendering is offscreen, frames never wait for a vsync.
+
+namespace {
+
+  struct preset {
+    char const* name;
+    int iterations;
+    int max_steps;
+    float min_distance;
+    // hits within this fraction of a pixel, 0 uses min_distance
+    float hit_footprint;
+    float power;
+  };
+
+  struct mode {
+    char const* name;
+    bool cone_prepass;
+    bool reprojection;
+    // over-relaxation of the march steps, 1 marches plainly
+    float relaxation;
+  };
+
+  struct flight {
+    ::std::string name;
+    ::irg::bezier::bezier_curve position;
+    ::irg::bezier::bezier_curve target;
+  };
+
+  struct resolution {
+    int width;
+    int height;
+  };
+
+  ::std::vector<preset> const presets{
+    {"default",  8,  64,  0.001f,  0.25f, 4.0f},
+    {"fixed",    8,  64,  0.001f,  0.0f, 4.0f},
+    {"detailed", 12, 128, 0.0001f, 0.0f, 8.0f},
+  };
+
+  ::std::vector<mode> const modes{
+    {"full",      false, false, 1.0f},
+    {"cone",      true,  false, 1.0f},
+    {"reproject", false, true,  1.0f},
+    {"combined",  true,  true,  1.0f},
+    {"relaxed",   false, false, 1.4f},
+  };
+
+  int constexpr cone_block = 8;
+  // vertical field of view of the flights, the viewer's default
+  float const fov = ::glm::radians(90.0f);
+
+  ::std::vector<flight> make_flights() {
+    using ::irg::bezier::compute_from;
+    return {
+      {
+        "approach",
+        compute_from({
+          {0.0, 0.0, -3.0}, {1.5, 1.0, -2.5}, {1.0, -0.5, -1.5},
+          {0.0, 0.0, -1.4},
+        }),
+        compute_from({{0.0, 0.0, 0.0}, {0.2, 0.1, 0.0}, {0.0, 0.0, 0.0}}),
+      },
+      {
+        "orbit",
+        compute_from({
+          {0.0, 0.0, -2.5}, {2.5, 0.5, -2.5}, {2.5, 0.5, 2.5},
+          {-2.5, -0.5, 2.5}, {-2.5, -0.5, -2.5}, {0.0, 0.0, -2.5},
+        }),
+        compute_from({{0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}}),
+      },
+    };
+  }
+
+  // flies the camera tracks of a timeline, frames spread over its duration
+  flight timeline_flight(::std::string const& name, ::irg::timeline t) {
+    auto const duration = t.duration();
+    auto const sampler = [duration, t = ::std::move(t)](
+                           char const* track, ::glm::vec3 value) {
+      return [=](float const s) {
+        auto v = value;
+        t.sample(track, s * duration, v);
+        return v;
+      };
+    };
+
+    return {
+      name,
+      sampler("camera.position", {0.0, 0.0, -2.0}),
+      sampler("camera.target", {0.0, 0.0, 0.0}),
+    };
+  }
+
+  struct quad {
+    unsigned vao;
+    unsigned buffers[2];
+
+    quad() {
+      float const vertices[] = {
+        1.0f, 1.0f, 1.0f, -1.0f, -1.0f, -1.0f, -1.0f, 1.0f,
+      };
+      unsigned const indices[] = {0, 1, 3, 1, 2, 3};
+
+      glGenVertexArrays(1, &vao);
+      glGenBuffers(2, buffers);
+      glBindVertexArray(vao);
+
+      glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+      glBufferData(
+        GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+      glBufferData(
+        GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+      glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
+      glEnableVertexAttribArray(0);
+    }
+
+    ~quad() {
+      glDeleteBuffers(2, buffers);
+      glDeleteVertexArrays(1, &vao);
+    }
+
+    void draw() const {
+      glBindVertexArray(vao);
+      glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    }
+  };
+
+  struct run_result {
+    double fps;
+    ::irg::percentiles cpu;
+    ::irg::percentiles gpu;
+    ::std::uint64_t steps;
+    ::std::uint64_t evaluations;
+  };
+
+  using uniform_block = ::irg::uniform_buffer<::irg::frame_uniforms>;
+
+  run_result run(::irg::shader_program& shader, uniform_block& block,
+                 quad const& q, flight const& f, mode const& m,
+                 preset const& p, resolution const r, int const frames) {
+    ::irg::frame_uniforms uniforms;
+    uniforms.resolution = {
+      static_cast<float>(r.width), static_cast<float>(r.height), 0.f};
+    uniforms.iterations    = p.iterations;
+    uniforms.max_steps     = p.max_steps;
+    uniforms.min_distance  = p.min_distance;
+    uniforms.hit_footprint = p.hit_footprint;
+    uniforms.power         = p.power;
+    uniforms.relaxation    = m.relaxation;
+
+    ::std::vector<unsigned> const formats{GL_RGBA8, GL_R32F, GL_RGBA32UI};
+    ::irg::framebuffer targets[2]{
+      {r.width, r.height, formats},
+      {r.width, r.height, formats},
+    };
+    // the cost of the cones goes to the attachment the targets keep theirs
+    // in
+    ::irg::framebuffer cones{
+      (r.width + cone_block - 1) / cone_block,
+      (r.height + cone_block - 1) / cone_block,
+      {GL_RG32F, GL_R32F, GL_RGBA32UI},
+    };
+
+    auto const march = [&](int const frame, ::glm::vec3 const& position,
+                           ::glm::vec3 const& target) {
+      auto const& current  = targets[frame % 2];
+      auto const& previous = targets[(frame + 1) % 2];
+
+      uniforms.camera = ::irg::ray_basis(position, target, fov);
+      block.upload(uniforms);
+
+      auto const reuse = m.reprojection && frame > 0;
+      shader.set_uniform_int("reproject", reuse);
+      if (reuse) {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, previous.texture(1));
+      }
+
+      shader.set_uniform_int("cone_start", m.cone_prepass);
+      if (m.cone_prepass) {
+        cones.bind();
+        shader.set_uniform_int("cone_pass", true);
+        q.draw();
+        shader.set_uniform_int("cone_pass", false);
+
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, cones.texture());
+      }
+
+      current.bind();
+      q.draw();
+
+      uniforms.previous_camera = uniforms.camera;
+    };
+
+    // the first frame pays for shader compilation in some drivers
+    march(0, f.position(0.0f), f.target(0.0f));
+    glFinish();
+
+    ::irg::frame_timer timer{static_cast<::std::size_t>(frames)};
+    double elapsed = 0.0;
+    ::std::uint64_t steps = 0;
+    ::std::uint64_t evaluations = 0;
+    ::irg::march_cost cost;
+    ::irg::march_cost cone_cost;
+
+    for (int i = 0; i < frames; ++i) {
+      auto const t = float(i) / ::std::max(1, frames - 1);
+      auto const position = f.position(t);
+      auto const target   = f.target(t);
+
+      auto const start = ::std::chrono::steady_clock::now();
+      timer.begin();
+      march(i, position, target);
+      // frames are timed until the GPU is done with them
+      glFinish();
+      timer.end({
+        r.width, r.height, p.iterations, p.max_steps, p.min_distance,
+        p.hit_footprint, p.power, position, target,
+      });
+      elapsed += ::std::chrono::duration<double>(
+        ::std::chrono::steady_clock::now() - start).count();
+
+      ::irg::read_march_cost(targets[i % 2], 2, cost);
+      if (m.cone_prepass)
+        ::irg::read_march_cost(cones, 2, cone_cost);
+      auto const stats = ::irg::reduce(
+        cost, m.cone_prepass ? &cone_cost : nullptr);
+      steps       += stats.steps;
+      evaluations += stats.evaluations;
+    }
+
+    timer.flush();
+    ::irg::assert_no_error();
+
+    return {frames / elapsed, timer.cpu(), timer.gpu(), steps, evaluations};
+  }
+
+}
+
+int main(int const argc, char const* const* argv) {
+  int frames = 120;
+  ::std::vector<resolution> resolutions;
+  ::std::vector<::std::string> shaders;
+  ::std::vector<::std::string> timelines;
+
+  for (int i = 1; i < argc; ++i) {
+    resolution r;
+    if (!::std::strcmp(argv[i], "--frames") && i + 1 < argc) {
+      frames = ::std::atoi(argv[++i]);
+    } else if (!::std::strcmp(argv[i], "--resolution") && i + 1 < argc) {
+      if (::std::sscanf(argv[++i], "%dx%d", &r.width, &r.height) != 2
+          || r.width <= 0 || r.height <= 0)
+        ::irg::terminate("Expected resolution as <width>x<height>.");
+      resolutions.push_back(r);
+    } else if (!::std::strcmp(argv[i], "--timeline") && i + 1 < argc) {
+      timelines.push_back(argv[++i]);
+    } else if (::std::filesystem::is_directory(argv[i])) {
+      for (auto const& entry : ::std::filesystem::directory_iterator(argv[i]))
+        if (entry.path().extension() == ".glsl")
+          shaders.push_back(entry.path().string());
+    } else {
+      shaders.push_back(argv[i]);
+    }
+  }
+
+  if (shaders.empty() || frames <= 0) {
+    ::irg::terminate(
+      "Expected command line arguments: <shader directory or paths>... "
+      "[--frames <count>] [--resolution <width>x<height>]... "
+      "[--timeline <keyframe file>]...\n"
+      "See 'data/shaders' folder of this repository.");
+  }
+
+  ::std::sort(shaders.begin(), shaders.end());
+  if (resolutions.empty())
+    resolutions = {{640, 360}, {1280, 720}};
+
+  auto guard = ::irg::init_headless();
+  ::irg::program_cache::open(::irg::program_cache::default_directory());
+
+  quad const q;
+  uniform_block block{::irg::frame_uniforms::binding};
+  auto flights = make_flights();
+  for (auto const& path : timelines) {
+    ::std::string error;
+    auto t = ::irg::load_timeline(path, error);
+    if (!t)
+      ::irg::terminate(error.c_str());
+    flights.push_back(timeline_flight(
+      ::std::filesystem::path(path).stem().string(), ::std::move(*t)));
+  }
+
+  ::std::cout
+    << "shader,flight,mode,preset,width,height,frames,fps,"
+    << "cpu_p50_ms,cpu_p95_ms,cpu_p99_ms,gpu_p50_ms,gpu_p95_ms,gpu_p99_ms,"
+    << "steps,evaluations\n";
+
+  for (auto const& path : shaders) {
+    ::irg::shader_program shader{::irg::program_sources{
+      "#version 330 core\n"
+      "layout (location = 0) in vec2 pos;\n"
+      "void main(){ gl_Position = vec4(pos, 0.0, 1.0); }",
+      ::irg::shader::read_file(path.c_str())
+    }};
+    shader.activate();
+    shader.set_uniform_int("previous_distance", 0);
+    shader.set_uniform_int("cone_distance", 1);
+    shader.set_uniform_int("cone_block", cone_block);
+
+    auto const name = ::std::filesystem::path(path).stem().string();
+
+    for (auto const& f : flights)
+      for (auto const& m : modes)
+        for (auto const& p : presets)
+          for (auto const& r : resolutions) {
+            auto const result = run(
+              shader, block, q, f, m, p, r, frames);
+
+            ::std::cout
+              << name << "," << f.name << "," << m.name << "," << p.name
+              << "," << r.width << "," << r.height << "," << frames
+              << "," << result.fps
+              << "," << result.cpu.p50 << "," << result.cpu.p95
+              << "," << result.cpu.p99
+              << "," << result.gpu.p50 << "," << result.gpu.p95
+              << "," << result.gpu.p99
+              << "," << result.steps << "," << result.evaluations
+              << ::std::endl;
+          }
+  }
+}
@@ -0,0 +1,73 @@
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+
+#include <irg/image.hpp>
+#include <irg/thread_pool.hpp>
+#include <irg/cpu_marcher.hpp>
+
+int main(int const argc, char const* const* argv) {
+  // vertical field of view in degrees, the default of the viewer
+  float fov = 90.0f;
+  ::std::vector<char const*> args;
+  for (int i = 1; i < argc; ++i) {
+    if (!::std::strcmp(argv[i], "--fov") && i + 1 < argc) {
+      fov = static_cast<float>(::std::atof(argv[++i]));
+      if (fov <= 0.0f || fov >= 180.0f) {
+        ::std::cerr << "Expected a field of view between 0 and 180 degrees.\n";
+        return EXIT_FAILURE;
+      }
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+
+  if (args.size() != 2 && args.size() != 4 && args.size() != 5) {
+    ::std::cerr
+      << "Usage: " << argv[0] 
+      << " <fragment shader path> <output.ppm> [<width> <height> [threads]]"
+      << " [--fov <degrees>]\n"
+      << "Renders the fractal of a shader from 'data/shaders' on the CPU.\n";
+    return EXIT_FAILURE;
+  }
+
+  ::irg::cpu::scene scene;
+  if (!::irg::cpu::scene_from_shader(args[0], scene)) {
+    ::std::cerr << "No CPU distance estimator for: " << args[0] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  auto const width   = args.size() >= 4 ? ::std::atoi(args[2]) : 400;
+  auto const height  = args.size() >= 4 ? ::std::atoi(args[3]) : 400;
+  auto const threads = args.size() == 5 
+    ? static_cast<unsigned>(::std::atoi(args[4]))
+    : ::std::thread::hardware_concurrency();
+
+  if (width <= 0 || height <= 0) {
+    ::std::cerr << "Invalid resolution.\n";
+    return EXIT_FAILURE;
+  }
+
+  ::irg::thread_pool pool{threads};
+  ::irg::image frame{width, height};
+
+  auto const start = ::std::chrono::steady_clock::now();
+  auto const stats = ::irg::cpu::render(
+    pool, scene, {}, {0, 0, -2}, {0, 0, 0}, ::glm::radians(fov), frame);
+  auto const elapsed = ::std::chrono::duration<double>(
+    ::std::chrono::steady_clock::now() - start).count();
+
+  if (!::irg::write_ppm(args[1], frame)) {
+    ::std::cerr << "Error while writing file: " << args[1] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  ::std::cout 
+    << width << "x" << height << " on " << pool.size() << " threads: "
+    << elapsed * 1000.0 << " ms, "
+    << stats.rays / elapsed / 1e6 << " Mrays/s, "
+    << stats.steps << " steps" << ::std::endl;
+}
@@ -1,8 +1,13 @@
 #include <irg/camera.hpp>
 
+#include <cmath>
+
 namespace irg {
 
-  void camera::update() noexcept {
+  bool camera::update() noexcept {
+    auto const old_position = position;
+    auto const old_target   = target;
+
     auto direction = ::glm::vec4{position - target, 1.0};
     auto rotate_around = 
     [&direction](auto& object, auto&& angle, auto&& mask) {
@@ -30,12 +35,18 @@ namespace irg {
 
     zoom(position, zoom_sensitivity[0], -zoom_mask[0]);
     zoom(target, zoom_sensitivity[1], zoom_mask[1]);
+
+    return position != old_position || target != old_target;
   }
 
   ::glm::mat4 camera::view_matrix() noexcept {
     this->update();
     return ::glm::lookAt(position, target, {0.0, 1.0, 0.0}); 
   }
+
+  ::glm::mat4 camera::ray_basis() const noexcept {
+    return ::irg::ray_basis(position, target, fov);
+  }
   
   ::irg::keyboard_event_type::on_press standard_camera_controler(camera& camera) {
     return [&camera](auto&& key, auto&& released){
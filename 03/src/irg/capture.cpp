@@ -0,0 +1,315 @@
+#include <irg/capture.hpp>
+
+#include <cmath>
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <utility>
+#include <iostream>
+#include <filesystem>
+
+namespace irg {
+
+  namespace {
+
+    // BT.601 studio range, the default of YUV4MPEG2 readers
+    void append_y4m(image const& frame, ::std::vector<unsigned char>& out) {
+      static char const header[] = "FRAME\n";
+      out.insert(out.end(), header, header + sizeof(header) - 1);
+
+      auto const count = static_cast<::std::size_t>(frame.width) * frame.height;
+      auto const start = out.size();
+      out.resize(start + count * 3);
+      auto* y = out.data() + start;
+      auto* u = y + count;
+      auto* v = u + count;
+
+      auto const* p = frame.pixels.data();
+      for (::std::size_t i = 0; i < count; ++i, p += 3) {
+        int const r = p[0], g = p[1], b = p[2];
+        y[i] = static_cast<unsigned char>(
+          ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        u[i] = static_cast<unsigned char>(
+          ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        v[i] = static_cast<unsigned char>(
+          ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+      }
+    }
+
+  }
+
+  bool parse_capture_target(char const* spec, capture_target& target) {
+    struct prefix {
+      char const* name;
+      capture_target::format kind;
+    };
+    prefix const prefixes[] = {
+      {"png:",  capture_target::format::png},
+      {"y4m:",  capture_target::format::y4m},
+      {"pipe:", capture_target::format::pipe},
+      {"gif:",  capture_target::format::gif},
+      {"gif-global:", capture_target::format::gif_global},
+    };
+
+    for (auto const& p : prefixes) {
+      auto const length = ::std::strlen(p.name);
+      if (!::std::strncmp(spec, p.name, length) && spec[length]) {
+        target = {p.kind, spec + length};
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool clip_capture_target(capture_target const& target,
+                           ::std::string const& name, capture_target& clip) {
+    clip = target;
+    switch (target.kind) {
+      case capture_target::format::png:
+        clip.destination += name + "_";
+        return true;
+      case capture_target::format::y4m:
+      case capture_target::format::gif:
+      case capture_target::format::gif_global: {
+        ::std::filesystem::path path{target.destination};
+        auto const extension = path.extension();
+        path.replace_filename(path.stem().string() + "_" + name);
+        path += extension;
+        clip.destination = path.string();
+        return true;
+      }
+      case capture_target::format::pipe:
+        break;
+    }
+    return false;
+  }
+
+  frame_writer::frame_writer(capture_target target, double const fps,
+                             unsigned const threads)
+    : target(::std::move(target))
+    , fps(fps)
+    , pool(threads)
+    , limit(2 * pool.size() + 2)
+  {}
+
+  frame_writer::~frame_writer() {
+    finish();
+  }
+
+  bool frame_writer::open() {
+    switch (target.kind) {
+      case capture_target::format::png:
+        return true;
+      case capture_target::format::y4m:
+      case capture_target::format::gif:
+      case capture_target::format::gif_global:
+        stream = {
+          ::std::fopen(target.destination.c_str(), "wb"), ::std::fclose};
+        break;
+      case capture_target::format::pipe:
+        // a command that quits early fails the writes instead of the program
+        ::std::signal(SIGPIPE, SIG_IGN);
+        stream = {::popen(target.destination.c_str(), "w"), ::pclose};
+        break;
+    }
+    return static_cast<bool>(stream);
+  }
+
+  void frame_writer::write(image&& frame) {
+    if (target.kind != capture_target::format::png) {
+      if (!submitted) {
+        width  = frame.width;
+        height = frame.height;
+        if (target.kind == capture_target::format::gif_global)
+          global = gif::quantize(frame);
+      } else if (frame.width != width || frame.height != height) {
+        if (!::std::exchange(warned, true))
+          ::std::cerr << "Dropping captured frames not sized "
+                      << width << "x" << height << "\n";
+        return;
+      }
+    }
+
+    {
+      ::std::unique_lock lock(m);
+      room.wait(lock, [this]{ return queued < limit; });
+      ++queued;
+    }
+
+    // tasks have to be copyable
+    auto const shared = ::std::make_shared<image>(::std::move(frame));
+    pool.submit([this, index = submitted++, shared]{
+      encode(index, *shared);
+
+      {
+        ::std::lock_guard lock(m);
+        --queued;
+      }
+      room.notify_one();
+    });
+  }
+
+  void frame_writer::encode(::std::uint64_t const index, image const& frame) {
+    ::std::vector<unsigned char> bytes;
+
+    switch (target.kind) {
+      case capture_target::format::png: {
+        char number[16];
+        ::std::snprintf(number, sizeof(number), "%04llu",
+                        static_cast<unsigned long long>(index));
+        auto const path = target.destination + number + ".png";
+        if (!write_png(path.c_str(), frame)) {
+          ::std::lock_guard lock(m);
+          if (!::std::exchange(failed, true))
+            ::std::cerr << "Error while writing file: " << path << "\n";
+        }
+        return;
+      }
+      case capture_target::format::y4m:
+        if (!index) {
+          char header[96];
+          auto const length = ::std::snprintf(
+            header, sizeof(header),
+            "YUV4MPEG2 W%d H%d F%ld:1000 Ip A1:1 C444\n",
+            frame.width, frame.height, ::std::lround(fps * 1000.0));
+          bytes.insert(bytes.end(), header, header + length);
+        }
+        append_y4m(frame, bytes);
+        break;
+      case capture_target::format::pipe:
+        bytes = frame.pixels;
+        break;
+      case capture_target::format::gif:
+      case capture_target::format::gif_global:
+        if (!index)
+          gif::header(frame.width, frame.height, global, bytes);
+        // GIF delays are hundredths of a second, viewers treat less than 2
+        // as slow
+        gif::frame(frame, global,
+                   ::std::max(2l, ::std::lround(100.0 / fps)), bytes);
+        break;
+    }
+
+    emit(index, ::std::move(bytes));
+  }
+
+  void frame_writer::emit(::std::uint64_t const index,
+                          ::std::vector<unsigned char>&& bytes) {
+    ::std::lock_guard lock(order);
+    done.emplace(index, ::std::move(bytes));
+
+    // whoever finishes the next frame writes every one ready after it
+    for (auto iter = done.begin();
+         iter != done.end() && iter->first == next;
+         iter = done.erase(iter), ++next) {
+      auto const& data = iter->second;
+      if (::std::fwrite(data.data(), 1, data.size(), stream.get())
+            != data.size()) {
+        ::std::lock_guard lock(m);
+        if (!::std::exchange(failed, true))
+          ::std::cerr << "Error while writing to: "
+                      << target.destination << "\n";
+      }
+    }
+  }
+
+  bool frame_writer::finish() {
+    pool.wait_idle();
+    if (stream && submitted
+        && (target.kind == capture_target::format::gif
+            || target.kind == capture_target::format::gif_global))
+      ::std::fputc(gif::trailer, stream.get());
+    if (stream && ::std::fflush(stream.get()))
+      failed = true;
+    stream.reset();
+    return !failed;
+  }
+
+  frame_capture::frame_capture(frame_writer& writer,
+                               ::std::size_t const ring_size)
+    : writer(writer)
+    , ring(ring_size ? ring_size : 1)
+  {
+    for (auto& s : ring)
+      glGenBuffers(1, &s.buffer);
+  }
+
+  frame_capture::~frame_capture() {
+    flush();
+    for (auto& s : ring)
+      glDeleteBuffers(1, &s.buffer);
+  }
+
+  void frame_capture::capture(unsigned const fbo, int const width,
+                              int const height) {
+    poll();
+    // the whole ring is still being copied, only now the render thread waits
+    if (pending == ring.size())
+      take(true);
+
+    auto& s = ring[(first + pending) % ring.size()];
+    auto const size = static_cast<::std::size_t>(width) * height * 3;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.buffer);
+    if (size > s.capacity) {
+      glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+      s.capacity = size;
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glReadBuffer(fbo ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    s.fence  = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    s.width  = width;
+    s.height = height;
+    ++pending;
+  }
+
+  void frame_capture::poll() {
+    while (pending && take(false))
+      ;
+  }
+
+  void frame_capture::flush() {
+    while (pending)
+      take(true);
+  }
+
+  bool frame_capture::take(bool const wait) {
+    auto& s = ring[first];
+
+    // the flush makes sure the fence is ever signaled
+    auto const status = glClientWaitSync(
+      s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GL_TIMEOUT_IGNORED : 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+      return false;
+    glDeleteSync(s.fence);
+    s.fence = nullptr;
+
+    image frame{s.width, s.height};
+    auto const stride = static_cast<::std::size_t>(s.width) * 3;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.buffer);
+    auto const* mapped = static_cast<unsigned char const*>(glMapBufferRange(
+      GL_PIXEL_PACK_BUFFER, 0, stride * s.height, GL_MAP_READ_BIT));
+    if (mapped) {
+      // GL rows start at the bottom
+      for (int y = 0; y < s.height; ++y)
+        ::std::memcpy(frame.row(s.height - 1 - y), mapped + y * stride,
+                      stride);
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    first = (first + 1) % ring.size();
+    --pending;
+
+    if (mapped)
+      writer.write(::std::move(frame));
+    return true;
+  }
+
+}
@@ -5,11 +5,29 @@
 
 namespace irg {
 
+  namespace detail {
+    bool invalidated = true;
+    bool polling = false;
+    ::GLADloadproc proc_loader = nullptr;
+  }
+
+  void invalidate() noexcept {
+    detail::invalidated = true;
+  }
+
+  void wake_soon() noexcept {
+    detail::polling = true;
+  }
+
   void terminate(char const* err) {
     ::std::cerr << err << "\n";
     ::std::exit(EXIT_FAILURE);
   }
 
+  void* gl_proc_address(char const* name) {
+    return detail::proc_loader ? detail::proc_loader(name) : nullptr;
+  }
+
   void assert_no_error() {
     if (auto err = glGetError(); err) {
       ::std::cerr << ::std::hex << err << "\n";
@@ -38,16 +56,19 @@ namespace irg {
     ::glfwMakeContextCurrent(w);
     ::glfwSetWindowPos(w, (1920 - width) / 2, (1080 - height) / 2);
 
-    if (!::gladLoadGLLoader(
-          reinterpret_cast<::GLADloadproc>(::glfwGetProcAddress)))
+    detail::proc_loader = 
+      reinterpret_cast<::GLADloadproc>(::glfwGetProcAddress);
+    if (!::gladLoadGLLoader(detail::proc_loader))
       terminate("Unable to initialize GLAD.");
 
     glViewport(0, 0, width, height);
     glfwSetFramebufferSizeCallback(w, window_events::buffer_size_callback);
     w_events.add_listener([](auto const w, auto const h) {
       glViewport(0, 0, w, h);
+      invalidate();
       return ob::action::remain;
     });
+    glfwSetWindowRefreshCallback(w, [](auto*) { invalidate(); });
 
     /* glfwSetFramebufferSizeCallback( // resizing
       w, [](auto*, auto const w, auto const h) { glViewport(0, 0, w, h); }); */
@@ -62,10 +83,22 @@ namespace irg {
     }
   }
 
-  void window_loop(::GLFWwindow* window, ::std::function<void(void)> render) {
+  void window_loop(::GLFWwindow* window, ::std::function<void(void)> render,
+                   ::std::function<bool(void)> update) {
     while (!::glfwWindowShouldClose(window)) {
       detail::default_inputs(window);
 
+      bool const changed = update ? update() : true;
+      if (!changed && !detail::invalidated) {
+        // the last swapped frame stays on screen
+        if (::std::exchange(detail::polling, false))
+          ::glfwWaitEventsTimeout(0.005);
+        else
+          ::glfwWaitEvents();
+        continue;
+      }
+
+      detail::invalidated = false;
       render();
 
       ::glfwPollEvents();
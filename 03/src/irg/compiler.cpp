@@ -0,0 +1,194 @@
+#include <irg/compiler.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+namespace irg {
+
+  namespace {
+
+    // workers of the pool, every one costs a hidden window
+    unsigned constexpr max_workers = 4;
+
+    build_result build(program_sources const& sources) {
+      build_result result;
+      result.program = shader_program::try_build(sources, result.log);
+      return result;
+    }
+
+    bool has_extension(char const* name) {
+      int count = 0;
+      glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+      for (int i = 0; i < count; ++i)
+        if (auto const* e = glGetStringi(GL_EXTENSIONS, i);
+            e && !::std::strcmp(reinterpret_cast<char const*>(e), name))
+          return true;
+      return false;
+    }
+
+    // turns on parallel builds of the current context if it has them
+    bool enable_parallel_compile() {
+      using max_threads_t = void (*)(unsigned);
+
+      for (auto const* suffix : {"KHR", "ARB"}) {
+        if (!has_extension(
+              (::std::string{"GL_"} + suffix + "_parallel_shader_compile")
+                .c_str()))
+          continue;
+
+        // lets the driver pick the number of threads
+        if (auto const max_threads = reinterpret_cast<max_threads_t>(
+              gl_proc_address(
+                (::std::string{"glMaxShaderCompilerThreads"} + suffix)
+                  .c_str())))
+          max_threads(0xFFFFFFFF);
+        return true;
+      }
+
+      return false;
+    }
+
+  }
+
+  background_compiler::background_compiler(bool const windowed,
+                                           ::std::function<void(void)> notify)
+    : notify(::std::move(notify))
+  {
+    if ((parallel = enable_parallel_compile()) || !windowed)
+      return;
+
+    auto const count = ::std::clamp(
+      ::std::thread::hardware_concurrency() / 2, 1u, max_workers);
+
+    ::glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    for (unsigned i = 0; i < count; ++i)
+      if (auto* context = ::glfwCreateWindow(
+            1, 1, "", nullptr, ::glfwGetCurrentContext()))
+        contexts.push_back(context);
+    ::glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+    if (contexts.empty()) {
+      ::std::cerr << "Unable to create a shared context, "
+                  << "programs are built on the render thread.\n";
+      return;
+    }
+
+    for (auto* context : contexts)
+      workers.emplace_back([this, context]{ run(context); });
+  }
+
+  background_compiler::~background_compiler() {
+    {
+      ::std::lock_guard lock(m);
+      stopping = true;
+    }
+    job_available.notify_all();
+
+    for (auto& worker : workers)
+      worker.join();
+    for (auto* context : contexts)
+      ::glfwDestroyWindow(context);
+  }
+
+  ::std::future<build_result> background_compiler::submit(
+      program_sources sources) {
+    ::std::promise<build_result> promise;
+    auto future = promise.get_future();
+
+    if (!asynchronous()) {
+      promise.set_value(build(sources));
+      return future;
+    }
+
+    {
+      ::std::lock_guard lock(m);
+      jobs.push_back({::std::move(sources), ::std::move(promise)});
+    }
+
+    if (parallel) {
+      // poll starts it on the render thread
+      if (notify)
+        notify();
+    } else {
+      job_available.notify_one();
+    }
+    return future;
+  }
+
+  bool background_compiler::poll() {
+    if (!parallel)
+      return false;
+
+    ::std::deque<job> submitted;
+    {
+      ::std::lock_guard lock(m);
+      submitted.swap(jobs);
+    }
+    for (auto& j : submitted)
+      running.push_back({
+        shader_program::start_build(::std::move(j.sources)),
+        ::std::move(j.promise),
+      });
+
+    for (auto i = running.begin(); i != running.end();)
+      if (i->build.ready()) {
+        finish(*i);
+        i = running.erase(i);
+      } else {
+        ++i;
+      }
+
+    return !running.empty();
+  }
+
+  void background_compiler::wait(::std::future<build_result> const& f) {
+    auto const done = [&f]{
+      return f.wait_for(::std::chrono::seconds{0})
+        == ::std::future_status::ready;
+    };
+
+    // parallel builds only move on when they are finished here
+    while (parallel && poll() && !done()) {
+      finish(running.front());
+      running.pop_front();
+    }
+
+    f.wait();
+  }
+
+  void background_compiler::finish(in_flight& f) {
+    build_result result;
+    result.program = f.build.finish(result.log);
+    f.promise.set_value(::std::move(result));
+  }
+
+  void background_compiler::run(::GLFWwindow* context) {
+    ::glfwMakeContextCurrent(context);
+
+    while (true) {
+      job j;
+      {
+        ::std::unique_lock lock(m);
+        job_available.wait(lock, [this]{ return stopping || !jobs.empty(); });
+        if (stopping)
+          break;
+
+        j = ::std::move(jobs.front());
+        jobs.pop_front();
+      }
+
+      auto result = build(j.sources);
+      // the other context may only use the program once it is complete
+      glFinish();
+      j.promise.set_value(::std::move(result));
+
+      if (notify)
+        notify();
+    }
+
+    ::glfwMakeContextCurrent(nullptr);
+  }
+
+}
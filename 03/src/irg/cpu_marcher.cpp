@@ -0,0 +1,388 @@
+#include <irg/cpu_marcher.hpp>
+
+#include <cmath>
+#include <atomic>
+#include <algorithm>
+
+#include <irg/simd.hpp>
+#include <irg/ray_basis.hpp>
+
+namespace irg::cpu {
+
+  namespace {
+
+    using simd::f8;
+    using simd::m8;
+    using simd::v3;
+
+    float constexpr maximum_trace_distance = 100.0;
+
+    // x^n by squaring, n >= 0
+    f8 int_pow(f8 x, int n) {
+      f8 result = 1.0f;
+      for (; n > 0; n >>= 1) {
+        if (n & 1)
+          result = result * x;
+        x = x * x;
+      }
+      return result;
+    }
+
+    // (re, im)^n by squaring, n >= 0
+    void complex_pow(f8& re, f8& im, int n) {
+      f8 result_re = 1.0f, result_im = 0.0f;
+      for (; n > 0; n >>= 1) {
+        if (n & 1) {
+          f8 const t = result_re * re - result_im * im;
+          result_im  = simd::fma(result_re, im, result_im * re);
+          result_re  = t;
+        }
+        f8 const t = re * re - im * im;
+        im = 2.0f * re * im;
+        re = t;
+      }
+      re = result_re, im = result_im;
+    }
+
+    // power step of the mandelbulb for an integer power without any
+    // trigonometry, see triplex_pow in data/shaders/lib/distance.glsl
+    v3 triplex_pow(v3 const& z, int const n) {
+      f8 const rho = simd::sqrt(z.x * z.x + z.y * z.y);
+
+      // r^n * (cos(n * theta), sin(n * theta))
+      f8 polar_cos = z.z, polar_sin = rho;
+      complex_pow(polar_cos, polar_sin, n);
+
+      // (cos(n * phi), sin(n * phi)), phi is 0 on the z axis
+      m8 const axis = rho <= 0.0f;
+      f8 const inverse = 1.0f / simd::select(axis, 1.0f, rho);
+      f8 azimuth_cos = simd::select(axis, 1.0f, z.x * inverse);
+      f8 azimuth_sin = simd::select(axis, 0.0f, z.y * inverse);
+      complex_pow(azimuth_cos, azimuth_sin, n);
+
+      return {polar_sin * azimuth_cos, polar_sin * azimuth_sin, polar_cos};
+    }
+
+    f8 mandelbulb_de(v3 const& pos, m8 live, march_parameters const& p) {
+      float constexpr bailout = 256.0f;
+      f8 const power = p.power;
+      f8 const power_m1 = p.power - 1.0f;
+
+      // the trigonometric form is only needed for fractional powers
+      auto const n = static_cast<int>(p.power);
+      bool const integer_power = p.power >= 2.0f && p.power == float(n);
+
+      v3 z = pos;
+      f8 dr = 1.0f;
+      f8 r = 0.0f;
+
+      for (int i = 0; i < p.iterations; ++i) {
+        f8 const length = simd::length(z);
+        r = simd::select(live, length, r);
+
+        live = live & (length <= bailout);
+        if (live.none())
+          break;
+
+        if (integer_power) {
+          dr = simd::select(
+            live, simd::fma(int_pow(r, n - 1) * power, dr, 1.0f), dr);
+          z = simd::select(live, triplex_pow(z, n) + pos, z);
+          continue;
+        }
+
+        f8 const theta = simd::acos(z.z / r) * power;
+        f8 const phi   = simd::atan2(z.y, z.x) * power;
+
+        f8 const r_pow = simd::pow(r, power_m1);
+        dr = simd::select(live, simd::fma(r_pow * power, dr, 1.0f), dr);
+
+        f8 const zr = r_pow * r;
+
+        f8 st, ct, sp, cp;
+        simd::sincos(theta, st, ct);
+        simd::sincos(phi, sp, cp);
+
+        v3 const next = v3{st * cp, sp * st, ct} * zr + pos;
+        z = simd::select(live, next, z);
+      }
+
+      return 0.5f * simd::log(r) * r / dr;
+    }
+
+    f8 sierpinski_de(v3 z, march_parameters const& p) {
+      for (int n = 0; n < p.iterations; ++n) {
+        auto fold = [](f8& a, f8& b) {
+          m8 const m = a + b < 0.0f;
+          f8 const na = simd::select(m, -b, a);
+          b = simd::select(m, -a, b);
+          a = na;
+        };
+
+        fold(z.x, z.y);
+        fold(z.x, z.z);
+        fold(z.z, z.y);
+
+        z = z * 2.0f - v3{1.0f, 1.0f, 1.0f};
+      }
+
+      return simd::length(z) * ::std::pow(2.0f, -float(p.iterations));
+    }
+
+    f8 distance_from_sphere(v3 const& p, v3 const& c, f8 const r) {
+      return simd::max(0.0f, simd::length(p - c) - r);
+    }
+
+    f8 balls_de(v3 const& p) {
+      auto wrap = [](f8 const x, float const c) {
+        // GLSL mod: x - y * floor(x / y)
+        f8 const shifted = x + 0.5f * c;
+        return shifted - c * simd::floor(shifted / c) - 0.5f * c;
+      };
+
+      return distance_from_sphere(
+        {wrap(p.x, 5.0f), wrap(p.y, 2.0f), wrap(p.z, 2.0f)},
+        {0.0f, 0.0f, 0.0f},
+        0.5f
+      );
+    }
+
+    f8 single_ball_de(v3 const& p) {
+      return distance_from_sphere(p, {0.0f, 0.0f, 3.0f}, 2.0f);
+    }
+
+    f8 distance_estimate(scene const& s, march_parameters const& p,
+                         v3 const& pos, m8 const live) {
+      switch (s.de) {
+        case estimator::mandelbulb:  return mandelbulb_de(pos, live, p);
+        case estimator::sierpinski:  return sierpinski_de(pos, p);
+        case estimator::balls:       return balls_de(pos);
+        case estimator::single_ball: return single_ball_de(pos);
+      }
+      return 0.0f;
+    }
+
+    // ray parameters where a hit is possible, entry > exit on a miss, see
+    // the bounding volumes in data/shaders/lib/distance.glsl
+    struct interval {
+      f8 entry;
+      f8 exit;
+    };
+
+    interval sphere_bounds(v3 const& ro, v3 const& rd, v3 const& c,
+                           float r, float const min_distance) {
+      r += min_distance;
+      v3 const oc = ro - c;
+      f8 const a = simd::dot(rd, rd);
+      f8 const b = simd::dot(oc, rd);
+      f8 const discriminant = b * b - a * (simd::dot(oc, oc) - r * r);
+
+      m8 const miss = discriminant < 0.0f;
+      f8 const root = simd::sqrt(simd::max(0.0f, discriminant));
+      return {
+        simd::select(miss, 1.0f, simd::max(0.0f, (-b - root) / a)),
+        simd::select(miss, 0.0f,
+                     simd::min(maximum_trace_distance, (-b + root) / a)),
+      };
+    }
+
+    interval box_bounds(v3 const& ro, v3 const& rd, float const low,
+                        float const high, float const min_distance) {
+      f8 entry = 0.0f, exit = maximum_trace_distance;
+      auto slab = [&](f8 const o, f8 const d) {
+        f8 const inverse = 1.0f / d;
+        f8 const t0 = (low - min_distance - o) * inverse;
+        f8 const t1 = (high + min_distance - o) * inverse;
+        entry = simd::max(entry, simd::min(t0, t1));
+        exit  = simd::min(exit, simd::max(t0, t1));
+      };
+
+      slab(ro.x, rd.x);
+      slab(ro.y, rd.y);
+      slab(ro.z, rd.z);
+      return {entry, exit};
+    }
+
+    interval bounds(scene const& s, march_parameters const& p,
+                    v3 const& ro, v3 const& rd) {
+      switch (s.de) {
+        case estimator::mandelbulb:
+          if (p.power > 1.0f)
+            return sphere_bounds(
+              ro, rd, {0.0f, 0.0f, 0.0f},
+              ::std::min(::std::pow(2.0f, 1.0f / (p.power - 1.0f)) * 1.1f,
+                         maximum_trace_distance),
+              p.min_distance);
+          break;
+        case estimator::sierpinski:
+          return box_bounds(ro, rd, -1.0f, 1.0f, p.min_distance);
+        case estimator::single_ball:
+          return sphere_bounds(
+            ro, rd, {0.0f, 0.0f, 3.0f}, 2.0f, p.min_distance);
+        case estimator::balls:
+          break;
+      }
+      return {0.0f, maximum_trace_distance};
+    }
+
+    struct march_result {
+      f8 steps;
+      f8 distance;
+    };
+
+    // lanes leave the loop independently, the packet is done once all are
+    march_result ray_march(scene const& s, march_parameters const& p,
+                           v3 const& ro, v3 const& rd) {
+      auto const volume = bounds(s, p, ro, rd);
+      f8 traveled = volume.entry;
+      // the jump to the volume counts as a step, as in the shaders
+      f8 const first_step = simd::select(volume.entry > 0.0f, 1.0f, 0.0f);
+      march_result mr{f8{float(p.max_steps)}, f8{-1.0f}};
+      m8 active = volume.entry <= volume.exit;
+      if (active.none())
+        return mr;
+
+      for (int i = 0; i < p.max_steps; ++i) {
+        v3 const current = ro + rd * traveled;
+        f8 const closest = distance_estimate(s, p, current, active);
+
+        m8 const hit = active & (closest < p.min_distance);
+        mr.steps    = simd::select(hit, first_step + float(i + 1), mr.steps);
+        mr.distance = simd::select(hit, traveled, mr.distance);
+        active      = simd::andnot(active, hit);
+
+        traveled = simd::select(active, traveled + closest, traveled);
+        m8 const done = (traveled > volume.exit)
+          | (first_step + float(i + 1) >= float(p.max_steps));
+        active = simd::andnot(active, done);
+
+        if (active.none())
+          break;
+      }
+
+      return mr;
+    }
+
+    // camera_ray of the shaders, fragment coordinates are y up
+    ::glm::vec3 ray_direction(scene const& s, ::glm::vec2 const& frag,
+                              ::glm::vec2 const& resolution,
+                              ::glm::mat3 const& basis) {
+      ::glm::vec2 uv = (frag / resolution) * 2.0f - ::glm::vec2{1.0f, 1.0f};
+      uv.x *= resolution.x / resolution.y;
+      if (s.mirrored)
+        uv.x = ::std::abs(uv.x);
+      return basis * ::glm::vec3{uv, 1.0f};
+    }
+
+    void shade(scene const& s, march_parameters const& p, float const steps,
+               float const distance, unsigned char* rgb) {
+      float r = 0.0f, g = 0.0f, b = 0.0f;
+
+      if (distance > 0.0f) {
+        auto const fraction = steps / p.max_steps;
+        if (s.color == coloring::steps) {
+          auto const ratio  = ::std::min(1.0f, 1.2f - fraction);
+          auto const ratio2 = ratio * ratio;
+          r = ratio, g = ratio2, b = 1.0f - ratio2 * ratio;
+        } else {
+          r = g = b = 1.0f - ::std::max(0.2f, fraction);
+        }
+      }
+
+      auto quantize = [](float const c) {
+        return static_cast<unsigned char>(
+          ::std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+      };
+
+      rgb[0] = quantize(r);
+      rgb[1] = quantize(g);
+      rgb[2] = quantize(b);
+    }
+
+  }
+
+  bool scene_from_shader(::std::string const& path, scene& s) {
+    auto const slash = path.find_last_of("/\\");
+    auto name = path.substr(slash == ::std::string::npos ? 0 : slash + 1);
+    name = name.substr(0, name.find_last_of('.'));
+
+    s = scene{};
+    if (name == "mandelbulb" || name == "base")
+      s.de = estimator::mandelbulb;
+    else if (name == "mandelbulb_light")
+      s.de = estimator::mandelbulb, s.color = coloring::steps_grayscale;
+    else if (name == "sierpinski")
+      s.de = estimator::sierpinski;
+    else if (name == "infinite_balls")
+      s.de = estimator::balls;
+    else if (name == "infinite_balls_mirrored")
+      s.de = estimator::balls, s.mirrored = true;
+    else if (name == "single_ball")
+      s.de = estimator::single_ball;
+    else
+      return false;
+
+    return true;
+  }
+
+  render_stats render(thread_pool& pool, scene const& s,
+                      march_parameters const& params,
+                      ::glm::vec3 const& camera_position,
+                      ::glm::vec3 const& camera_target, float const fov,
+                      image& out, int const tile_size) {
+    auto const tiles_x = (out.width + tile_size - 1) / tile_size;
+    auto const tiles_y = (out.height + tile_size - 1) / tile_size;
+
+    ::glm::vec2 const resolution{out.width, out.height};
+    v3 const ro{camera_position.x, camera_position.y, camera_position.z};
+    auto const basis = ::glm::mat3(
+      ::irg::ray_basis(camera_position, camera_target, fov));
+
+    ::std::atomic<::std::uint64_t> total_steps{0};
+
+    pool.parallel_for(tiles_x * tiles_y, [&](::std::size_t const tile) {
+      auto const x0 = static_cast<int>(tile % tiles_x) * tile_size;
+      auto const y0 = static_cast<int>(tile / tiles_x) * tile_size;
+      auto const x1 = ::std::min(x0 + tile_size, out.width);
+      auto const y1 = ::std::min(y0 + tile_size, out.height);
+
+      ::std::uint64_t steps = 0;
+      alignas(32) float dx[simd::width], dy[simd::width], dz[simd::width];
+      alignas(32) float lane_steps[simd::width], lane_distance[simd::width];
+
+      for (int row = y0; row < y1; ++row)
+        for (int x = x0; x < x1; x += simd::width) {
+          auto const lanes = ::std::min(simd::width, x1 - x);
+
+          for (int l = 0; l < simd::width; ++l) {
+            // pad partial packets by repeating the last ray
+            ::glm::vec2 const frag{
+              ::std::min(x + l, x + lanes - 1) + 0.5f,
+              out.height - 1 - row + 0.5f,
+            };
+            auto const rd = ray_direction(s, frag, resolution, basis);
+            dx[l] = rd.x, dy[l] = rd.y, dz[l] = rd.z;
+          }
+
+          auto const mr = ray_march(
+            s, params, ro, {f8::load(dx), f8::load(dy), f8::load(dz)});
+          mr.steps.store(lane_steps);
+          mr.distance.store(lane_distance);
+
+          for (int l = 0; l < lanes; ++l) {
+            steps += static_cast<::std::uint64_t>(lane_steps[l]);
+            shade(s, params, lane_steps[l], lane_distance[l],
+                  out.row(row) + (x + l) * 3);
+          }
+        }
+
+      total_steps += steps;
+    });
+
+    return {
+      static_cast<::std::uint64_t>(out.width) * out.height,
+      total_steps.load(),
+    };
+  }
+
+}
@@ -0,0 +1,365 @@
+#include <irg/gif.hpp>
+
+#include <array>
+#include <cstdint>
+#include <algorithm>
+
+namespace irg::gif {
+
+  namespace {
+
+    using bytes = ::std::vector<unsigned char>;
+
+    int constexpr bits = 5;
+    int constexpr side = 1 << bits;
+
+    int bin_of(int const r, int const g, int const b) noexcept {
+      int constexpr shift = 8 - bits;
+      return (r >> shift) << (2 * bits) | (g >> shift) << bits | b >> shift;
+    }
+
+    int channel_of(int const bin, int const c) noexcept {
+      return (bin >> (bits * (2 - c))) & (side - 1);
+    }
+
+    // pixels of a histogram bin and the sum of their channels
+    struct entry {
+      int bin;
+      ::std::uint32_t count;
+      ::std::uint64_t sum[3];
+    };
+
+    void put_u16(bytes& out, int const v) {
+      out.push_back(v & 0xff);
+      out.push_back((v >> 8) & 0xff);
+    }
+
+    // smallest n with 2^n >= colors, at least 1 as GIF tables require
+    int table_bits(::std::size_t const colors) noexcept {
+      int n = 1;
+      while ((::std::size_t{1} << n) < colors)
+        ++n;
+      return n;
+    }
+
+    // the table padded with black to a power of two
+    void put_table(bytes& out, palette const& p) {
+      out.insert(out.end(), p.begin(), p.end());
+      auto const size = ::std::size_t{1} << table_bits(p.size() / 3);
+      out.insert(out.end(), size * 3 - p.size(), 0);
+    }
+
+    // Nearest palette color of every histogram bin, looked up once per bin
+    // the first time a pixel falls into it.
+    class matcher {
+      palette const& p;
+      ::std::vector<short> cache;
+
+     public:
+      explicit matcher(palette const& p)
+        : p(p), cache(side * side * side, -1) {}
+
+      int operator()(int const r, int const g, int const b) {
+        auto& cached = cache[bin_of(r, g, b)];
+        if (cached >= 0)
+          return cached;
+
+        int best = 0;
+        int best_distance = -1;
+        for (::std::size_t i = 0; i < p.size() / 3; ++i) {
+          auto const dr = r - p[i * 3];
+          auto const dg = g - p[i * 3 + 1];
+          auto const db = b - p[i * 3 + 2];
+          auto const d  = dr * dr + dg * dg + db * db;
+          if (best_distance < 0 || d < best_distance) {
+            best_distance = d;
+            best = static_cast<int>(i);
+          }
+        }
+        return cached = static_cast<short>(best);
+      }
+    };
+
+    // Floyd-Steinberg, the error of every pixel is pushed to the ones right
+    // and below it
+    ::std::vector<unsigned char> dither(image const& img, palette const& p) {
+      ::std::vector<unsigned char> ret(
+        static_cast<::std::size_t>(img.width) * img.height);
+      matcher nearest{p};
+
+      auto const stride = static_cast<::std::size_t>(img.width + 2) * 3;
+      ::std::vector<int> current(stride, 0);
+      ::std::vector<int> below(stride, 0);
+
+      for (int y = 0; y < img.height; ++y) {
+        auto const* row = img.row(y);
+        for (int x = 0; x < img.width; ++x) {
+          int wanted[3];
+          for (int c = 0; c < 3; ++c)
+            wanted[c] = ::std::clamp(
+              row[x * 3 + c] + current[(x + 1) * 3 + c] / 16, 0, 255);
+
+          auto const index = nearest(wanted[0], wanted[1], wanted[2]);
+          ret[static_cast<::std::size_t>(y) * img.width + x] = index;
+
+          for (int c = 0; c < 3; ++c) {
+            auto const error = wanted[c] - p[index * 3 + c];
+            current[(x + 2) * 3 + c] += error * 7;
+            below[x * 3 + c]         += error * 3;
+            below[(x + 1) * 3 + c]   += error * 5;
+            below[(x + 2) * 3 + c]   += error;
+          }
+        }
+
+        current.swap(below);
+        ::std::fill(below.begin(), below.end(), 0);
+      }
+
+      return ret;
+    }
+
+    // GIF flavoured LZW, codes packed from the least significant bit into
+    // sub-blocks of at most 255 bytes
+    void compress(::std::vector<unsigned char> const& indices,
+                  int const min_code_size, bytes& out) {
+      int constexpr max_codes = 4096;
+      int constexpr hash_size = 8192;
+
+      out.push_back(min_code_size);
+
+      bytes block;
+      ::std::uint32_t buffer = 0;
+      int buffered = 0;
+      auto const put = [&](int const code, int const size) {
+        buffer |= static_cast<::std::uint32_t>(code) << buffered;
+        buffered += size;
+        while (buffered >= 8) {
+          block.push_back(buffer & 0xff);
+          buffer >>= 8;
+          buffered -= 8;
+          if (block.size() == 255) {
+            out.push_back(255);
+            out.insert(out.end(), block.begin(), block.end());
+            block.clear();
+          }
+        }
+      };
+
+      int const clear = 1 << min_code_size;
+      int const end   = clear + 1;
+
+      // open addressing from (prefix, index) to the code of the string
+      ::std::vector<::std::int32_t> keys(hash_size);
+      ::std::vector<short> codes(hash_size);
+      int next_code = 0;
+      int code_size = 0;
+      auto const reset = [&]{
+        ::std::fill(keys.begin(), keys.end(), -1);
+        next_code = end + 1;
+        code_size = min_code_size + 1;
+      };
+
+      reset();
+      put(clear, code_size);
+
+      int prefix = -1;
+      for (auto const index : indices) {
+        if (prefix < 0) {
+          prefix = index;
+          continue;
+        }
+
+        auto const key = prefix << 8 | index;
+        auto slot = static_cast<int>((key * 2654435761u) >> 19)
+          & (hash_size - 1);
+        while (keys[slot] >= 0 && keys[slot] != key)
+          slot = (slot + 1) & (hash_size - 1);
+
+        if (keys[slot] == key) {
+          prefix = codes[slot];
+          continue;
+        }
+
+        put(prefix, code_size);
+        if (next_code < max_codes) {
+          keys[slot]  = key;
+          codes[slot] = static_cast<short>(next_code);
+          // the decoder widens its codes one code later than it adds them
+          if (next_code++ == (1 << code_size) && code_size < 12)
+            ++code_size;
+        } else {
+          put(clear, code_size);
+          reset();
+        }
+        prefix = index;
+      }
+
+      if (prefix >= 0)
+        put(prefix, code_size);
+      put(end, code_size);
+      if (buffered)
+        put(0, 8 - buffered);
+
+      if (!block.empty()) {
+        out.push_back(static_cast<unsigned char>(block.size()));
+        out.insert(out.end(), block.begin(), block.end());
+      }
+      out.push_back(0);
+    }
+
+  }
+
+  palette quantize(image const& img, int const colors) {
+    ::std::vector<entry> histogram(side * side * side, entry{});
+    auto const* p = img.pixels.data();
+    for (::std::size_t i = 0; i < img.pixels.size(); i += 3) {
+      auto& e = histogram[bin_of(p[i], p[i + 1], p[i + 2])];
+      ++e.count;
+      for (int c = 0; c < 3; ++c)
+        e.sum[c] += p[i + c];
+    }
+
+    ::std::vector<entry> entries;
+    for (int bin = 0; bin < side * side * side; ++bin)
+      if (histogram[bin].count) {
+        entries.push_back(histogram[bin]);
+        entries.back().bin = bin;
+      }
+
+    // boxes are ranges of entries, the one holding the most pixels spread
+    // over the widest channel is split at its median
+    struct box {
+      ::std::size_t begin;
+      ::std::size_t end;
+    };
+    ::std::vector<box> boxes;
+    if (!entries.empty())
+      boxes.push_back({0, entries.size()});
+
+    auto const limit = static_cast<::std::size_t>(::std::clamp(colors, 2, 256));
+    while (boxes.size() < limit) {
+      ::std::uint64_t best_score = 0;
+      ::std::size_t best = boxes.size();
+      int best_channel = 0;
+
+      for (::std::size_t b = 0; b < boxes.size(); ++b) {
+        if (boxes[b].end - boxes[b].begin < 2)
+          continue;
+
+        int low[3] = {side, side, side};
+        int high[3] = {0, 0, 0};
+        ::std::uint64_t count = 0;
+        for (auto i = boxes[b].begin; i < boxes[b].end; ++i) {
+          for (int c = 0; c < 3; ++c) {
+            low[c]  = ::std::min(low[c], channel_of(entries[i].bin, c));
+            high[c] = ::std::max(high[c], channel_of(entries[i].bin, c));
+          }
+          count += entries[i].count;
+        }
+
+        int channel = 0;
+        for (int c = 1; c < 3; ++c)
+          if (high[c] - low[c] > high[channel] - low[channel])
+            channel = c;
+        auto const score = count * (high[channel] - low[channel]);
+        if (score > best_score) {
+          best_score = score;
+          best = b;
+          best_channel = channel;
+        }
+      }
+
+      if (best == boxes.size())
+        break;
+
+      auto const [begin, end] = boxes[best];
+      ::std::sort(entries.begin() + begin, entries.begin() + end,
+        [&](entry const& a, entry const& b) {
+          return channel_of(a.bin, best_channel)
+            < channel_of(b.bin, best_channel);
+        });
+
+      ::std::uint64_t total = 0;
+      for (auto i = begin; i < end; ++i)
+        total += entries[i].count;
+
+      auto split = begin + 1;
+      for (::std::uint64_t seen = entries[begin].count;
+           split < end - 1 && seen * 2 < total; ++split)
+        seen += entries[split].count;
+
+      boxes[best] = {begin, split};
+      boxes.push_back({split, end});
+    }
+
+    // every color is the mean of the pixels in its box
+    palette ret;
+    for (auto const& b : boxes) {
+      ::std::uint64_t sum[3] = {0, 0, 0};
+      ::std::uint64_t count = 0;
+      for (auto i = b.begin; i < b.end; ++i) {
+        for (int c = 0; c < 3; ++c)
+          sum[c] += entries[i].sum[c];
+        count += entries[i].count;
+      }
+      for (int c = 0; c < 3; ++c)
+        ret.push_back(static_cast<unsigned char>(sum[c] / count));
+    }
+
+    if (ret.empty())
+      ret = {0, 0, 0};
+    return ret;
+  }
+
+  void header(int const width, int const height, palette const& global,
+              ::std::vector<unsigned char>& out) {
+    static char const signature[] = "GIF89a";
+    out.insert(out.end(), signature, signature + 6);
+
+    put_u16(out, width);
+    put_u16(out, height);
+    if (global.empty()) {
+      out.insert(out.end(), {0, 0, 0});
+    } else {
+      // global table, 8 bits of color resolution
+      out.push_back(0x80 | 0x70 | (table_bits(global.size() / 3) - 1));
+      out.insert(out.end(), {0, 0});
+      put_table(out, global);
+    }
+
+    // loop forever
+    static unsigned char const netscape[] = {
+      0x21, 0xff, 0x0b, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0',
+      0x03, 0x01, 0x00, 0x00, 0x00,
+    };
+    out.insert(out.end(), ::std::begin(netscape), ::std::end(netscape));
+  }
+
+  void frame(image const& img, palette const& global, int const delay,
+             ::std::vector<unsigned char>& out) {
+    auto const local = global.empty() ? quantize(img) : palette{};
+    auto const& p = global.empty() ? local : global;
+
+    // graphic control, every frame replaces the previous one
+    out.insert(out.end(), {0x21, 0xf9, 0x04, 0x04});
+    put_u16(out, delay);
+    out.insert(out.end(), {0, 0});
+
+    out.push_back(0x2c);
+    put_u16(out, 0);
+    put_u16(out, 0);
+    put_u16(out, img.width);
+    put_u16(out, img.height);
+
+    auto const size = table_bits(p.size() / 3);
+    if (global.empty()) {
+      out.push_back(0x80 | (size - 1));
+      put_table(out, p);
+    } else {
+      out.push_back(0);
+    }
+
+    compress(dither(img, p), ::std::max(2, size), out);
+  }
+
+}
@@ -0,0 +1,73 @@
+#include <irg/headless.hpp>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+namespace irg {
+
+  namespace detail {
+    ::EGLDisplay headless_display() {
+      auto const get_platform_display = 
+        reinterpret_cast<::PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+          ::eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+      if (get_platform_display)
+        if (auto d = get_platform_display(
+              EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            d != EGL_NO_DISPLAY)
+          return d;
+
+      return ::eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+  }
+
+  on_scope_exit init_headless(int const major_version, 
+                              int const minor_version) {
+    auto display = detail::headless_display();
+    if (display == EGL_NO_DISPLAY || !::eglInitialize(display, nullptr, nullptr))
+      terminate("Unable to initialize EGL.");
+
+    if (!::eglBindAPI(EGL_OPENGL_API))
+      terminate("EGL implementation does not support desktop OpenGL.");
+
+    ::EGLint const config_attributes[] = {
+      EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+      EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+      EGL_NONE,
+    };
+
+    ::EGLConfig config;
+    ::EGLint configs = 0;
+    if (!::eglChooseConfig(display, config_attributes, &config, 1, &configs)
+        || !configs)
+      config = EGL_NO_CONFIG_KHR;
+
+    ::EGLint const context_attributes[] = {
+      EGL_CONTEXT_MAJOR_VERSION, major_version,
+      EGL_CONTEXT_MINOR_VERSION, minor_version,
+      EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+      EGL_NONE,
+    };
+
+    auto context = ::eglCreateContext(
+      display, config, EGL_NO_CONTEXT, context_attributes);
+    if (context == EGL_NO_CONTEXT)
+      terminate("Unable to create an EGL context.");
+
+    // rendering goes to framebuffer objects, no surface needed
+    if (!::eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+      terminate("Unable to make the EGL context current.");
+
+    detail::proc_loader = 
+      reinterpret_cast<::GLADloadproc>(::eglGetProcAddress);
+    if (!::gladLoadGLLoader(detail::proc_loader))
+      terminate("Unable to initialize GLAD.");
+
+    return on_scope_exit{[display, context]{
+      ::eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+      ::eglDestroyContext(display, context);
+      ::eglTerminate(display);
+    }};
+  }
+
+}
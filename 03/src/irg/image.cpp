@@ -0,0 +1,324 @@
+#include <irg/image.hpp>
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <algorithm>
+
+namespace irg {
+
+  namespace {
+
+    using bytes = ::std::vector<unsigned char>;
+
+    ::std::uint32_t crc32(unsigned char const* data, ::std::size_t const size,
+                          ::std::uint32_t crc = 0) noexcept {
+      static auto const table = []{
+        ::std::array<::std::uint32_t, 256> t{};
+        for (::std::uint32_t n = 0; n < 256; ++n) {
+          auto c = n;
+          for (int k = 0; k < 8; ++k)
+            c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+          t[n] = c;
+        }
+        return t;
+      }();
+
+      crc = ~crc;
+      for (::std::size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+      return ~crc;
+    }
+
+    ::std::uint32_t adler32(bytes const& data) noexcept {
+      ::std::uint32_t a = 1, b = 0;
+      for (::std::size_t i = 0; i < data.size();) {
+        // largest run before b can overflow
+        auto const end = ::std::min(data.size(), i + 5552);
+        for (; i < end; ++i) {
+          a += data[i];
+          b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+      }
+      return b << 16 | a;
+    }
+
+    void put_u32(bytes& out, ::std::uint32_t const v) {
+      out.push_back(v >> 24);
+      out.push_back(v >> 16);
+      out.push_back(v >> 8);
+      out.push_back(v);
+    }
+
+    // deflate streams are packed starting from the least significant bit
+    class bit_writer {
+      bytes& out;
+      ::std::uint32_t bits = 0;
+      int count = 0;
+
+     public:
+      explicit bit_writer(bytes& out) : out(out) {}
+
+      void put(::std::uint32_t const value, int const n) {
+        bits |= value << count;
+        count += n;
+        while (count >= 8) {
+          out.push_back(bits & 0xff);
+          bits >>= 8;
+          count -= 8;
+        }
+      }
+
+      // huffman codes go most significant bit first
+      void put_code(::std::uint32_t const code, int const n) {
+        ::std::uint32_t reversed = 0;
+        for (int i = 0; i < n; ++i)
+          reversed |= ((code >> i) & 1) << (n - 1 - i);
+        put(reversed, n);
+      }
+
+      void flush() {
+        if (count)
+          out.push_back(bits & 0xff);
+        bits = count = 0;
+      }
+    };
+
+    int constexpr length_base[] = {
+      3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51,
+      59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+    };
+    int constexpr length_extra[] = {
+      0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4,
+      4, 5, 5, 5, 5, 0,
+    };
+    int constexpr distance_base[] = {
+      1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+      513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385,
+      24577,
+    };
+    int constexpr distance_extra[] = {
+      0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10,
+      10, 11, 11, 12, 12, 13, 13,
+    };
+
+    // symbol of the fixed huffman code
+    void put_literal(bit_writer& w, int const symbol) {
+      if (symbol < 144)
+        w.put_code(0x30 + symbol, 8);
+      else if (symbol < 256)
+        w.put_code(0x190 + symbol - 144, 9);
+      else if (symbol < 280)
+        w.put_code(symbol - 256, 7);
+      else
+        w.put_code(0xc0 + symbol - 280, 8);
+    }
+
+    template<::std::size_t N>
+    int code_of(int const (&base)[N], int const value) {
+      return static_cast<int>(
+        ::std::upper_bound(base, base + N, value) - base) - 1;
+    }
+
+    void put_match(bit_writer& w, int const length, int const distance) {
+      auto const l = code_of(length_base, length);
+      put_literal(w, 257 + l);
+      w.put(length - length_base[l], length_extra[l]);
+
+      auto const d = code_of(distance_base, distance);
+      w.put_code(d, 5);
+      w.put(distance - distance_base[d], distance_extra[d]);
+    }
+
+    // One block with the fixed huffman codes, matches found through hash
+    // chains of the last three bytes. Plenty for the large flat areas of
+    // the renders, and far simpler than dynamic codes.
+    void deflate(bytes const& data, bytes& out) {
+      int constexpr window     = 1 << 15;
+      int constexpr hash_size  = 1 << 15;
+      int constexpr max_chain  = 32;
+      int constexpr min_match  = 3;
+      int constexpr max_match  = 258;
+
+      bit_writer w{out};
+      w.put(1, 1); // last block
+      w.put(1, 2); // fixed codes
+
+      ::std::vector<int> head(hash_size, -1);
+      ::std::vector<int> previous(window, -1);
+
+      auto const size = static_cast<int>(data.size());
+      auto const hash = [&](int const i) {
+        return ((data[i] << 10) ^ (data[i + 1] << 5) ^ data[i + 2])
+          & (hash_size - 1);
+      };
+      auto const insert = [&](int const i) {
+        if (i + min_match > size)
+          return;
+        auto& h = head[hash(i)];
+        previous[i & (window - 1)] = h;
+        h = i;
+      };
+
+      for (int i = 0; i < size;) {
+        int best_length = 0;
+        int best_distance = 0;
+
+        if (i + min_match <= size) {
+          auto const limit = ::std::min(max_match, size - i);
+          auto candidate = head[hash(i)];
+          for (int chain = 0;
+               candidate >= 0 && i - candidate <= window && chain < max_chain;
+               ++chain) {
+            int length = 0;
+            while (length < limit
+                   && data[candidate + length] == data[i + length])
+              ++length;
+            if (length > best_length) {
+              best_length = length;
+              best_distance = i - candidate;
+              if (length == limit)
+                break;
+            }
+            candidate = previous[candidate & (window - 1)];
+          }
+        }
+
+        if (best_length >= min_match) {
+          put_match(w, best_length, best_distance);
+          for (int k = 0; k < best_length; ++k)
+            insert(i + k);
+          i += best_length;
+        } else {
+          put_literal(w, data[i]);
+          insert(i++);
+        }
+      }
+
+      put_literal(w, 256);
+      w.flush();
+    }
+
+    int paeth(int const a, int const b, int const c) noexcept {
+      auto const p  = a + b - c;
+      auto const pa = ::std::abs(p - a);
+      auto const pb = ::std::abs(p - b);
+      auto const pc = ::std::abs(p - c);
+      return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+    }
+
+    // Filters every row with whichever of the five PNG filters leaves the
+    // smallest sum of magnitudes, the usual heuristic for what deflates
+    // best.
+    bytes filter(image const& img) {
+      auto const stride = static_cast<::std::size_t>(img.width) * 3;
+      bytes ret;
+      ret.reserve((stride + 1) * img.height);
+
+      bytes const zero(stride, 0);
+      bytes candidate(stride);
+      bytes best(stride);
+
+      for (int y = 0; y < img.height; ++y) {
+        auto const* row   = img.row(y);
+        auto const* above = y ? img.row(y - 1) : zero.data();
+
+        long best_cost = -1;
+        unsigned char best_type = 0;
+        for (unsigned char type = 0; type < 5; ++type) {
+          long cost = 0;
+          for (::std::size_t x = 0; x < stride; ++x) {
+            int const a = x >= 3 ? row[x - 3] : 0;
+            int const b = above[x];
+            int const c = x >= 3 ? above[x - 3] : 0;
+
+            int predicted = 0;
+            switch (type) {
+              case 1: predicted = a; break;
+              case 2: predicted = b; break;
+              case 3: predicted = (a + b) / 2; break;
+              case 4: predicted = paeth(a, b, c); break;
+            }
+
+            auto const v = static_cast<unsigned char>(row[x] - predicted);
+            candidate[x] = v;
+            cost += v < 128 ? v : 256 - v;
+          }
+
+          if (best_cost < 0 || cost < best_cost) {
+            best_cost = cost;
+            best_type = type;
+            best.swap(candidate);
+          }
+        }
+
+        ret.push_back(best_type);
+        ret.insert(ret.end(), best.begin(), best.end());
+      }
+
+      return ret;
+    }
+
+    void put_chunk(bytes& out, char const* type, bytes const& data) {
+      put_u32(out, static_cast<::std::uint32_t>(data.size()));
+      auto const start = out.size();
+      out.insert(out.end(), type, type + 4);
+      out.insert(out.end(), data.begin(), data.end());
+      put_u32(out, crc32(out.data() + start, out.size() - start));
+    }
+
+  }
+
+  bool write_ppm(char const* path, image const& img) {
+    ::std::ofstream f(path, ::std::ios::binary);
+    if (!f.is_open())
+      return false;
+
+    f << "P6\n" << img.width << " " << img.height << "\n255\n";
+    f.write(
+      reinterpret_cast<char const*>(img.pixels.data()), 
+      img.pixels.size()
+    );
+
+    return static_cast<bool>(f);
+  }
+
+  void encode_png(image const& img, ::std::vector<unsigned char>& out) {
+    out.clear();
+    unsigned char const signature[] = {
+      0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n',
+    };
+    out.insert(out.end(), ::std::begin(signature), ::std::end(signature));
+
+    bytes header;
+    put_u32(header, img.width);
+    put_u32(header, img.height);
+    // 8 bits per channel, RGB, deflate, adaptive filters, not interlaced
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+    put_chunk(out, "IHDR", header);
+
+    auto const filtered = filter(img);
+    bytes stream{0x78, 0x01};
+    deflate(filtered, stream);
+    put_u32(stream, adler32(filtered));
+    put_chunk(out, "IDAT", stream);
+
+    put_chunk(out, "IEND", {});
+  }
+
+  bool write_png(char const* path, image const& img) {
+    bytes encoded;
+    encode_png(img, encoded);
+
+    ::std::ofstream f(path, ::std::ios::binary);
+    if (!f.is_open())
+      return false;
+
+    f.write(reinterpret_cast<char const*>(encoded.data()), encoded.size());
+    return static_cast<bool>(f);
+  }
+
+}
@@ -0,0 +1,122 @@
+#include <irg/library.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <filesystem>
+
+#include <irg/preprocessor.hpp>
+
+namespace irg {
+
+  fractal_library::fractal_library(
+      ::std::vector<::std::string> const& paths,
+      ::std::string const& vertex_source,
+      background_compiler& compiler)
+    : compiler(compiler)
+  {
+    fractals.reserve(paths.size());
+
+    for (auto const& path : paths) {
+      auto& f = fractals.emplace_back();
+      f.path = path;
+      f.name = ::std::filesystem::path(path).stem().string();
+
+      ::std::string error;
+      auto source = preprocess(path, error);
+      if (!source) {
+        ::std::cerr << error << "\n";
+        f.broken = true;
+        continue;
+      }
+
+      f.sources  = {vertex_source, ::std::move(*source)};
+      f.building = compiler.submit(f.sources);
+    }
+
+    // the first one is submitted first, waiting for it does not wait for
+    // the others
+    if (fractals.empty() || fractals.front().broken)
+      ::irg::terminate("Unable to build the first fractal.");
+
+    auto& first = fractals.front();
+    compiler.wait(first.building);
+    collect(first);
+    if (first.broken)
+      ::irg::terminate("Unable to build the first fractal.");
+  }
+
+  void fractal_library::select(::std::size_t const i) {
+    if (i >= fractals.size())
+      return;
+
+    if (fractals[i].broken) {
+      ::std::cerr << fractals[i].name << " did not build, "
+                  << "staying with " << fractals[current].name << ".\n";
+      return;
+    }
+
+    selected = i;
+    if (!fractals[i].program)
+      ::std::cout << "building: " << fractals[i].name << "\n";
+  }
+
+  void fractal_library::poll(shader_program& program) {
+    for (auto& f : fractals)
+      if (f.building.valid()
+          && f.building.wait_for(::std::chrono::seconds{0})
+               == ::std::future_status::ready)
+        collect(f);
+
+    if (fractals[selected].broken)
+      selected = current;
+    if (selected != current && fractals[selected].program)
+      activate(program, selected);
+
+    fractals[current].variants->poll(program);
+  }
+
+  void fractal_library::wait(shader_program& program) {
+    if (auto& f = fractals[selected]; f.building.valid()) {
+      compiler.wait(f.building);
+      collect(f);
+    }
+    poll(program);
+  }
+
+  void fractal_library::reload(shader_program& program,
+                               reloaded_program next) {
+    auto& f = fractals[current];
+    program.replace(next.program);
+
+    f.sources = ::std::move(next.sources);
+    f.program = ::std::move(next.program);
+    f.variants->reset(f.sources, *f.program);
+  }
+
+  void fractal_library::request(shader_program& program, defines const& d) {
+    fractals[current].variants->request(program, d);
+  }
+
+  void fractal_library::collect(fractal& f) {
+    auto result = f.building.get();
+    if (!result.program) {
+      ::std::cerr << "Error while building " << f.path << ":\n"
+                  << result.log << "\n";
+      f.broken = true;
+      return;
+    }
+
+    f.program = ::std::move(result.program);
+    f.variants.emplace(f.sources, *f.program, compiler);
+  }
+
+  void fractal_library::activate(shader_program& program,
+                                 ::std::size_t const i) {
+    program.replace(*fractals[i].program);
+    // program holds the generic one now, the next request brings the
+    // variant back
+    fractals[i].variants->restart();
+    current = i;
+  }
+
+}
@@ -0,0 +1,203 @@
+#include <irg/march_cost.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <algorithm>
+
+namespace irg {
+
+  namespace {
+
+    // same ramp as heat() of the overlay shader below
+    ::glm::vec3 heat(float const t) {
+      auto const x = ::std::clamp(t, 0.0f, 1.0f);
+      return {
+        ::std::clamp(2.0f * x - 0.5f, 0.0f, 1.0f),
+        ::std::clamp(1.5f - ::std::abs(4.0f * x - 2.0f), 0.0f, 1.0f),
+        ::std::clamp(1.0f - 2.0f * x, 0.0f, 1.0f),
+      };
+    }
+
+    char const* const overlay_vertex =
+      "#version 330 core\n"
+      "void main() {\n"
+      "  vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+      "  gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+      "}\n";
+
+    char const* const overlay_fragment =
+      "#version 330 core\n"
+      "uniform usampler2D cost;\n"
+      "uniform int max_steps;\n"
+      "uniform float opacity;\n"
+      "uniform vec3 scale;\n"
+      "out vec4 frag_color;\n"
+      "vec3 heat(float t) {\n"
+      "  float x = clamp(t, 0.0, 1.0);\n"
+      "  return clamp(vec3(2.0 * x - 0.5, 1.5 - abs(4.0 * x - 2.0),\n"
+      "                    1.0 - 2.0 * x), 0.0, 1.0);\n"
+      "}\n"
+      "void main() {\n"
+      "  ivec2 texel = ivec2(gl_FragCoord.xy * scale.xy);\n"
+      "  uvec4 c = texelFetch(cost, texel, 0);\n"
+      "  vec3 color = c.z == 3u\n"
+      "    ? vec3(1.0) : heat(float(c.y) / float(max_steps));\n"
+      "  frag_color = vec4(color, opacity);\n"
+      "}\n";
+
+  }
+
+  void read_march_cost(framebuffer const& source,
+                       ::std::size_t const attachment, march_cost& out) {
+    out.width  = source.width;
+    out.height = source.height;
+    out.pixels.resize(static_cast<::std::size_t>(out.width) * out.height * 4);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, source.id());
+    glReadBuffer(GL_COLOR_ATTACHMENT0 + attachment);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, out.width, out.height, GL_RGBA_INTEGER,
+                 GL_UNSIGNED_INT, out.pixels.data());
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+  }
+
+  march_statistics reduce(march_cost const& cost, march_cost const* cone) {
+    march_statistics stats;
+
+    auto count = [](::std::vector<::std::uint64_t>& histogram,
+                    unsigned const value) {
+      if (histogram.size() <= value)
+        histogram.resize(value + 1);
+      ++histogram[value];
+    };
+
+    for (::std::size_t i = 0; i < cost.pixels.size(); i += 4) {
+      auto const* c = cost.pixels.data() + i;
+
+      ++stats.pixels;
+      stats.steps       += c[0];
+      stats.evaluations += c[1];
+      ++stats.terminations[::std::min(c[2], 3u)];
+
+      count(stats.step_histogram, c[0]);
+      count(stats.evaluation_histogram, c[1]);
+    }
+
+    // cones are not pixels of the image, they only add to the total
+    if (cone)
+      for (::std::size_t i = 0; i < cone->pixels.size(); i += 4)
+        stats.cone_evaluations += cone->pixels[i + 1];
+    stats.evaluations += stats.cone_evaluations;
+
+    return stats;
+  }
+
+  bool write_statistics(char const* path, march_statistics const& stats) {
+    ::std::unique_ptr<::std::FILE, int(*)(::std::FILE*)> f{
+      ::std::fopen(path, "w"), ::std::fclose};
+    if (!f)
+      return false;
+
+    auto const& t = stats.terminations;
+    ::std::fprintf(f.get(),
+      "# pixels: %llu\n# steps: %llu\n# evaluations: %llu\n"
+      "# cone evaluations: %llu\n"
+      "# hit: %llu\n# escaped: %llu\n# exhausted: %llu\n# not marched: %llu\n",
+      static_cast<unsigned long long>(stats.pixels),
+      static_cast<unsigned long long>(stats.steps),
+      static_cast<unsigned long long>(stats.evaluations),
+      static_cast<unsigned long long>(stats.cone_evaluations),
+      static_cast<unsigned long long>(t[1]),
+      static_cast<unsigned long long>(t[2]),
+      static_cast<unsigned long long>(t[3]),
+      static_cast<unsigned long long>(t[0]));
+
+    ::std::fputs("count,pixels_with_steps,pixels_with_evaluations\n", f.get());
+
+    auto const rows = ::std::max(
+      stats.step_histogram.size(), stats.evaluation_histogram.size());
+    auto at = [](auto const& histogram, ::std::size_t const i) {
+      return static_cast<unsigned long long>(
+        i < histogram.size() ? histogram[i] : 0);
+    };
+
+    for (::std::size_t i = 0; i < rows; ++i)
+      ::std::fprintf(f.get(), "%zu,%llu,%llu\n", i,
+                     at(stats.step_histogram, i),
+                     at(stats.evaluation_histogram, i));
+
+    return !::std::ferror(f.get());
+  }
+
+  void heatmap(march_cost const& cost, int const max_steps, image& out) {
+    out = image{cost.width, cost.height};
+
+    for (int y = 0; y < cost.height; ++y)
+      for (int x = 0; x < cost.width; ++x) {
+        // cost rows start at the bottom
+        auto const* c = cost.at(x, cost.height - 1 - y);
+        auto const color =
+          c[2] == static_cast<unsigned>(termination::exhausted)
+            ? ::glm::vec3{1.0f, 1.0f, 1.0f}
+            : heat(static_cast<float>(c[1]) / ::std::max(1, max_steps));
+
+        auto* rgb = out.row(y) + x * 3;
+        for (int i = 0; i < 3; ++i)
+          rgb[i] = static_cast<unsigned char>(color[i] * 255.0f + 0.5f);
+      }
+  }
+
+  cost_overlay::cost_overlay()
+    : program({overlay_vertex, GL_VERTEX_SHADER},
+              {overlay_fragment, GL_FRAGMENT_SHADER})
+    , vao(deffer_ownership(
+        new unsigned{0},
+        [](auto* ptr) {
+          glDeleteVertexArrays(1, ptr);
+        }
+      ))
+  {
+    glGenVertexArrays(1, vao.get());
+  }
+
+  void cost_overlay::draw(framebuffer const& source,
+                          ::std::size_t const attachment,
+                          int const max_steps) {
+    int previous_program = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
+
+    int viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    program.activate();
+    program.set_uniform_int("cost", 0);
+    program.set_uniform_int("max_steps", max_steps);
+    program.set_uniform_float("opacity", opacity);
+
+    // the source may be smaller than the viewport it is shown in
+    program.set_uniform_vec3("scale", {
+      static_cast<float>(source.width) / viewport[2],
+      static_cast<float>(source.height) / viewport[3],
+      0.0f,
+    });
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, source.texture(attachment));
+
+    auto const depth_test = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glBindVertexArray(*vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    glDisable(GL_BLEND);
+    if (depth_test)
+      glEnable(GL_DEPTH_TEST);
+
+    glUseProgram(previous_program);
+  }
+
+}
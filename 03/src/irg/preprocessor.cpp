@@ -0,0 +1,177 @@
+#include <irg/preprocessor.hpp>
+
+#include <map>
+#include <mutex>
+#include <regex>
+#include <cstring>
+#include <sstream>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+
+namespace irg {
+
+  namespace {
+
+    namespace fs = ::std::filesystem;
+
+    // Lines of file n are numbered from n * line_stride on. Not every driver
+    // reports the source string number of #line, the line number survives.
+    int constexpr line_stride = 100000;
+
+    // appended for every file, "// source <n>: <path>"
+    char const* const source_marker = "// source ";
+
+    struct cached_file {
+      fs::file_time_type modified;
+      ::std::string text;
+    };
+
+    ::std::mutex cache_mutex;
+    ::std::map<::std::string, cached_file> cache;
+
+    ::std::optional<::std::string> load(fs::path const& path) {
+      ::std::error_code error;
+      auto const modified = fs::last_write_time(path, error);
+      if (error)
+        return ::std::nullopt;
+
+      {
+        ::std::lock_guard lock(cache_mutex);
+        if (auto const i = cache.find(path.string());
+            i != cache.end() && i->second.modified == modified)
+          return i->second.text;
+      }
+
+      ::std::ifstream f(path);
+      if (!f.is_open())
+        return ::std::nullopt;
+
+      ::std::string text{
+        (::std::istreambuf_iterator<char>(f)),
+        ::std::istreambuf_iterator<char>()
+      };
+
+      ::std::lock_guard lock(cache_mutex);
+      cache[path.string()] = {modified, text};
+      return text;
+    }
+
+    ::std::string line_directive(int const source, int const line) {
+      return "#line " + ::std::to_string(source * line_stride + line)
+        + " " + ::std::to_string(source) + "\n";
+    }
+
+    // the quoted path of an #include line, nothing for any other line
+    ::std::optional<::std::string> include_of(::std::string const& line) {
+      static ::std::regex const include{R"(^\s*#\s*include\s+"([^"]+)\")"};
+
+      ::std::smatch match;
+      if (!::std::regex_search(line, match, include))
+        return ::std::nullopt;
+      return match[1].str();
+    }
+
+    struct expansion {
+      // indexed by source string number
+      ::std::vector<::std::string> files;
+      ::std::string text;
+      ::std::string& error;
+    };
+
+    bool expand(fs::path const& path, expansion& e) {
+      auto const source = load(path);
+      if (!source) {
+        e.error = "Error while opening file: " + path.string();
+        return false;
+      }
+
+      auto const number = static_cast<int>(e.files.size());
+      e.files.push_back(path.string());
+      if (number)
+        e.text += line_directive(number, 1);
+
+      ::std::istringstream lines{*source};
+      ::std::string line;
+      for (int line_number = 1; ::std::getline(lines, line); ++line_number) {
+        auto const include = include_of(line);
+        if (!include) {
+          e.text += line + "\n";
+          continue;
+        }
+
+        auto const included =
+          (path.parent_path() / *include).lexically_normal();
+        if (::std::find(e.files.begin(), e.files.end(), included.string())
+            != e.files.end()) {
+          // already there, keeps the line count
+          e.text += "\n";
+          continue;
+        }
+
+        if (!expand(included, e))
+          return false;
+        e.text += line_directive(number, line_number + 1);
+      }
+
+      return true;
+    }
+
+  }
+
+  ::std::optional<::std::string> preprocess(::std::string const& path,
+                                            ::std::string& error) {
+    expansion e{{}, {}, error};
+    if (!expand(fs::path(path).lexically_normal(), e))
+      return ::std::nullopt;
+
+    for (::std::size_t i = 0; i < e.files.size(); ++i)
+      e.text += source_marker + ::std::to_string(i) + ": " + e.files[i] + "\n";
+    return e.text;
+  }
+
+  ::std::vector<::std::string> included_files(::std::string const& source) {
+    ::std::vector<::std::string> files;
+
+    auto const length = ::std::strlen(source_marker);
+    for (auto i = source.find(source_marker); i != ::std::string::npos;
+         i = source.find(source_marker, i + length)) {
+      auto const colon = source.find(": ", i);
+      auto const end   = source.find('\n', i);
+      if (colon < end)
+        files.push_back(source.substr(colon + 2, end - colon - 2));
+    }
+
+    return files;
+  }
+
+  ::std::string remap_log(::std::string const& log,
+                          ::std::string const& source) {
+    auto const files = included_files(source);
+    if (files.empty())
+      return log;
+
+    // "0:12(3): ..." from Mesa, "0(12) : ..." from NVIDIA and
+    // "ERROR: 0:12: ..." from AMD and Intel
+    static ::std::regex const location{
+      R"(^((?:ERROR|WARNING): )?(\d+)([:(])(\d+))"};
+
+    ::std::istringstream lines{log};
+    ::std::string line, remapped;
+    while (::std::getline(lines, line)) {
+      ::std::smatch match;
+      if (::std::regex_search(line, match, location)) {
+        auto const number = ::std::stol(match[4].str());
+        auto const file   = static_cast<::std::size_t>(number / line_stride);
+        if (file < files.size())
+          line = match[1].str() + files[file] + match[3].str()
+            + ::std::to_string(number % line_stride) + match.suffix().str();
+      }
+      remapped += line + "\n";
+    }
+
+    return remapped;
+  }
+
+}
@@ -0,0 +1,209 @@
+#include <irg/program_cache.hpp>
+
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <filesystem>
+#include <functional>
+
+#include <unistd.h>
+
+#include <glad/glad.h>
+
+#include <irg/common.hpp>
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+namespace irg::program_cache {
+
+  namespace {
+
+    // GL 4.1 / ARB_get_program_binary, not part of the generated glad
+    using get_program_binary_proc = void (APIENTRYP)(
+      GLuint, GLsizei, GLsizei*, GLenum*, void*);
+    using program_binary_proc = void (APIENTRYP)(
+      GLuint, GLenum, void const*, GLsizei);
+    using program_parameteri_proc = void (APIENTRYP)(GLuint, GLenum, GLint);
+
+    get_program_binary_proc get_program_binary = nullptr;
+    program_binary_proc program_binary = nullptr;
+    program_parameteri_proc program_parameteri = nullptr;
+
+    bool active = false;
+    ::std::filesystem::path directory;
+
+    char constexpr magic[8] = {'I', 'R', 'G', 'P', 'R', 'O', 'G', '1'};
+
+    struct header {
+      char magic[8];
+      ::std::uint64_t key;
+      ::std::uint32_t format;
+      ::std::uint32_t length;
+    };
+
+    // FNV-1a, stable across runs and builds unlike std::hash
+    void hash(::std::uint64_t& h, void const* data, ::std::size_t const size) {
+      auto const* bytes = static_cast<unsigned char const*>(data);
+      for (::std::size_t i = 0; i < size; ++i)
+        h = (h ^ bytes[i]) * 0x100000001b3ull;
+    }
+
+    void hash(::std::uint64_t& h, char const* s) {
+      // the terminator separates consecutive strings
+      if (s)
+        hash(h, s, ::std::strlen(s) + 1);
+      else
+        hash(h, "", 1);
+    }
+
+    ::std::filesystem::path path_of(::std::uint64_t const key) {
+      char name[32];
+      ::std::snprintf(name, sizeof(name), "%016llx.bin",
+                      static_cast<unsigned long long>(key));
+      return directory / name;
+    }
+
+  }
+
+  void open(::std::string const& dir) {
+    active = false;
+
+    get_program_binary = reinterpret_cast<get_program_binary_proc>(
+      gl_proc_address("glGetProgramBinary"));
+    program_binary = reinterpret_cast<program_binary_proc>(
+      gl_proc_address("glProgramBinary"));
+    program_parameteri = reinterpret_cast<program_parameteri_proc>(
+      gl_proc_address("glProgramParameteri"));
+
+    if (!get_program_binary || !program_binary || !program_parameteri
+        || dir.empty())
+      return;
+
+    int formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (glGetError() != GL_NO_ERROR || !formats)
+      return;
+
+    ::std::error_code error;
+    ::std::filesystem::create_directories(dir, error);
+    if (error) {
+      ::std::cerr << "Unable to create program cache " << dir << ": "
+                  << error.message() << "\n";
+      return;
+    }
+
+    directory = dir;
+    active    = true;
+  }
+
+  ::std::string default_directory() {
+    if (auto const* xdg = ::std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+      return ::std::string{xdg} + "/fractals";
+    if (auto const* home = ::std::getenv("HOME"); home && *home)
+      return ::std::string{home} + "/.cache/fractals";
+    return {};
+  }
+
+  bool enabled() noexcept {
+    return active;
+  }
+
+  ::std::uint64_t key(::std::string const& vertex_source,
+                      ::std::string const& fragment_source) {
+    ::std::uint64_t h = 0xcbf29ce484222325ull;
+
+    hash(h, vertex_source.c_str());
+    hash(h, fragment_source.c_str());
+    for (auto const name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+      hash(h, reinterpret_cast<char const*>(glGetString(name)));
+
+    return h;
+  }
+
+  bool load(unsigned const program, ::std::uint64_t const key) {
+    if (!active)
+      return false;
+
+    ::std::ifstream f(path_of(key), ::std::ios::binary);
+    if (!f.is_open())
+      return false;
+
+    header h;
+    if (!f.read(reinterpret_cast<char*>(&h), sizeof(h))
+        || ::std::memcmp(h.magic, magic, sizeof(magic)) || h.key != key)
+      return false;
+
+    ::std::vector<char> binary(h.length);
+    if (!f.read(binary.data(), binary.size()))
+      return false;
+
+    // errors of earlier calls are reported here, not taken for a refusal
+    ::irg::assert_no_error();
+    program_binary(program, h.format, binary.data(), h.length);
+    // an updated driver may refuse binaries of the old one, raising
+    // GL_INVALID_ENUM on the way
+    glGetError();
+
+    int success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+
+    return success;
+  }
+
+  void prepare(unsigned const program) {
+    if (active)
+      program_parameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, 1);
+  }
+
+  void store(unsigned const program, ::std::uint64_t const key) {
+    if (!active)
+      return;
+
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+      return;
+
+    ::std::vector<char> binary(length);
+    GLenum format = 0;
+    get_program_binary(program, length, &length, &format, binary.data());
+
+    header h;
+    ::std::memcpy(h.magic, magic, sizeof(magic));
+    h.key    = key;
+    h.format = format;
+    h.length = static_cast<::std::uint32_t>(length);
+
+    // renamed into place, so concurrent readers never see half a file
+    auto const target = path_of(key);
+    auto temporary = target;
+    temporary += "." + ::std::to_string(::getpid()) + "." + ::std::to_string(
+      ::std::hash<::std::thread::id>{}(::std::this_thread::get_id()));
+
+    bool written;
+    {
+      ::std::ofstream f(temporary, ::std::ios::binary | ::std::ios::trunc);
+      written = f.write(reinterpret_cast<char const*>(&h), sizeof(h))
+        && f.write(binary.data(), length);
+    }
+
+    ::std::error_code error;
+    if (written)
+      ::std::filesystem::rename(temporary, target, error);
+    if (!written || error)
+      ::std::filesystem::remove(temporary, error);
+  }
+
+}
@@ -0,0 +1,99 @@
+#include <irg/progressive.hpp>
+
+#include <cmath>
+#include <iterator>
+#include <algorithm>
+
+namespace irg {
+
+  void progressive_resolution::resize(int const w, int const h) noexcept {
+    width   = w;
+    height  = h;
+    resized = true;
+  }
+
+  bool progressive_resolution::advance(bool const changed, 
+                                       bool const moving) noexcept {
+    auto const now = clock::now();
+
+    if (moving) {
+      if (was_moving) {
+        auto const budget  = 1.0 / target_fps;
+        auto const elapsed = 
+          ::std::chrono::duration<double>(now - last_frame).count();
+
+        if (elapsed > budget * 1.1)
+          motion_scale *= 0.8f;
+        else if (elapsed < budget * 0.8)
+          motion_scale *= 1.1f;
+
+        motion_scale = ::std::clamp(motion_scale, min_scale, 1.0f);
+      }
+      current_scale = motion_scale;
+    } else if (changed || resized) {
+      current_scale = ::std::min(1.0f, max_scale);
+    } else if (current_scale != max_scale) {
+      current_scale = ::std::min(current_scale * 2.0f, max_scale);
+    } else if (!pending) {
+      was_moving = false;
+      return false;
+    }
+
+    was_moving = moving;
+    last_frame = now;
+    resized    = false;
+    pending    = true;
+    return true;
+  }
+
+  ::glm::ivec2 progressive_resolution::resolution() const noexcept {
+    return {
+      ::std::max(1, static_cast<int>(::std::lround(width * current_scale))),
+      ::std::max(1, static_cast<int>(::std::lround(height * current_scale))),
+    };
+  }
+
+  void progressive_resolution::render(march_callback const& march) {
+    if (pending) {
+      auto const r = resolution();
+
+      target_key key{r.x, r.y, 0};
+      if (latest && key == latest_key)
+        ::std::get<2>(key) = 1;
+
+      auto iter = targets.find(key);
+      if (iter == targets.end()) {
+        // adaptive motion scales produce many sizes, keep only a few
+        if (targets.size() >= 8)
+          for (auto i = targets.begin(); i != targets.end();)
+            i = i->first == latest_key ? ::std::next(i) : targets.erase(i);
+
+        iter = targets.emplace(key, framebuffer{r.x, r.y, formats}).first;
+      }
+
+      auto const* previous = latest;
+      latest     = &iter->second;
+      latest_key = key;
+
+      latest->bind();
+      march(*latest, previous);
+      pending = false;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+
+    if (!latest)
+      return;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, latest->id());
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBlitFramebuffer(
+      0, 0, latest->width, latest->height,
+      0, 0, width, height,
+      GL_COLOR_BUFFER_BIT, GL_LINEAR
+    );
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+  }
+
+}
@@ -0,0 +1,162 @@
+#include <irg/reload.hpp>
+#include <irg/preprocessor.hpp>
+
+#include <array>
+#include <chrono>
+#include <cerrno>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+namespace irg {
+
+  shader_reloader::shader_reloader(::std::string path,
+                                   ::std::string vertex_source,
+                                   background_compiler& compiler)
+    : path(::std::move(path))
+    , vertex_source(::std::move(vertex_source))
+    , compiler(compiler)
+  {
+    // builds on the render thread would stall it
+    if (!compiler.asynchronous()) {
+      ::std::cerr << "No background compiler, "
+                  << "shader reloading is disabled.\n";
+      return;
+    }
+
+    inotify = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify < 0 || ::pipe(wake)) {
+      ::std::cerr << "Unable to watch " << this->path
+                  << ", shader reloading is disabled.\n";
+      return;
+    }
+
+    ::std::string error;
+    watch(preprocess(this->path, error).value_or(""));
+    if (directories.empty()) {
+      ::std::cerr << "Unable to watch " << this->path
+                  << ", shader reloading is disabled.\n";
+      return;
+    }
+
+    worker = ::std::thread([this]{ run(); });
+  }
+
+  shader_reloader::~shader_reloader() {
+    if (worker.joinable()) {
+      char const stop = 0;
+      [[maybe_unused]] auto const written = ::write(wake[1], &stop, 1);
+      worker.join();
+    }
+
+    for (auto const fd : {inotify, wake[0], wake[1]})
+      if (fd >= 0)
+        ::close(fd);
+  }
+
+  ::std::optional<reloaded_program> shader_reloader::take() {
+    ::std::lock_guard lock(m);
+    if (!building.valid() 
+        || building.wait_for(::std::chrono::seconds{0}) 
+             != ::std::future_status::ready)
+      return ::std::nullopt;
+
+    auto result = building.get();
+    if (!result.program) {
+      ::std::cerr << "Error while reloading " << path << ", "
+                  << "keeping the previous program:\n" << result.log << "\n";
+      return ::std::nullopt;
+    }
+
+    ::std::cout << "reloaded: " << path << ::std::endl;
+    return reloaded_program{::std::move(sources), *result.program};
+  }
+
+  void shader_reloader::watch(::std::string const& source) {
+    files = included_files(source);
+    // a shader that does not preprocess is still watched for a fix
+    if (files.empty())
+      files.push_back(
+        ::std::filesystem::path(path).lexically_normal().string());
+
+    for (auto const& file : files) {
+      // editors replace files by renaming, so directories are watched
+      auto directory = ::std::filesystem::path(file).parent_path().string();
+      if (directory.empty())
+        directory = ".";
+
+      auto const wd = ::inotify_add_watch(inotify, directory.c_str(),
+                                          IN_CLOSE_WRITE | IN_MOVED_TO);
+      if (wd >= 0)
+        directories[wd] = directory;
+    }
+  }
+
+  void shader_reloader::run() {
+    alignas(::inotify_event) ::std::array<char, 4096> buffer;
+
+    // true if one of the pending events is about a watched file
+    auto const drain = [&]{
+      bool touched = false;
+      ::ssize_t n;
+      while ((n = ::read(inotify, buffer.data(), buffer.size())) > 0)
+        for (auto* p = buffer.data(); p < buffer.data() + n;) {
+          auto const* event = reinterpret_cast<::inotify_event const*>(p);
+          if (auto const d = directories.find(event->wd);
+              event->len && d != directories.end()) {
+            auto const file = (::std::filesystem::path(d->second) 
+              / event->name).lexically_normal().string();
+            if (::std::find(files.begin(), files.end(), file) != files.end())
+              touched = true;
+          }
+          p += sizeof(::inotify_event) + event->len;
+        }
+      return touched;
+    };
+
+    ::pollfd fds[2] = {
+      {inotify, POLLIN, 0},
+      {wake[0], POLLIN, 0},
+    };
+
+    while (true) {
+      if (::poll(fds, 2, -1) < 0) {
+        if (errno == EINTR)
+          continue;
+        break;
+      }
+
+      if (fds[1].revents)
+        break;
+
+      if (!drain())
+        continue;
+
+      // editors tend to save in several writes, let them settle
+      ::std::this_thread::sleep_for(::std::chrono::milliseconds{50});
+      drain();
+
+      rebuild();
+    }
+  }
+
+  void shader_reloader::rebuild() {
+    ::std::string error;
+    auto const source = preprocess(path, error);
+    if (!source) {
+      ::std::cerr << error << "\n";
+      return;
+    }
+    // includes may have been added or removed
+    watch(*source);
+
+    ::std::lock_guard lock(m);
+    sources  = {vertex_source, *source};
+    building = compiler.submit(sources);
+  }
+
+}
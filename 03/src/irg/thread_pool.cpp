@@ -0,0 +1,117 @@
+#include <irg/thread_pool.hpp>
+
+namespace irg {
+
+  namespace detail {
+    // index of the queue owned by the current thread, if it is a worker
+    thread_local thread_pool const* current_pool = nullptr;
+    thread_local unsigned current_worker = 0;
+  }
+
+  thread_pool::thread_pool(unsigned const threads) {
+    auto const n = threads ? threads : 1u;
+
+    for (unsigned i = 0; i < n; ++i)
+      queues.push_back(::std::make_unique<queue>());
+
+    for (unsigned i = 0; i < n; ++i)
+      workers.emplace_back([this, i]{ run(i); });
+  }
+
+  thread_pool::~thread_pool() {
+    {
+      ::std::lock_guard lock(m);
+      stopping = true;
+    }
+    work_available.notify_all();
+
+    for (auto& w : workers)
+      w.join();
+  }
+
+  void thread_pool::submit(task t) {
+    // tasks spawned from a worker stay local, the rest are spread round robin
+    auto const target = detail::current_pool == this
+      ? detail::current_worker
+      : next_queue++ % queues.size();
+
+    {
+      ::std::lock_guard lock(queues[target]->m);
+      queues[target]->tasks.push_back(::std::move(t));
+    }
+    {
+      ::std::lock_guard lock(m);
+      ++queued;
+      ++unfinished;
+    }
+    work_available.notify_one();
+  }
+
+  void thread_pool::wait_idle() {
+    ::std::unique_lock lock(m);
+    idle.wait(lock, [this]{ return unfinished == 0; });
+  }
+
+  void thread_pool::parallel_for(
+      ::std::size_t const count,
+      ::std::function<void(::std::size_t)> const& f) {
+    for (::std::size_t i = 0; i < count; ++i)
+      submit([&f, i]{ f(i); });
+    wait_idle();
+  }
+
+  bool thread_pool::try_take(unsigned const self, task& t) {
+    {
+      auto& own = *queues[self];
+      ::std::lock_guard lock(own.m);
+      if (!own.tasks.empty()) {
+        t = ::std::move(own.tasks.back());
+        own.tasks.pop_back();
+        return true;
+      }
+    }
+
+    for (::std::size_t i = 1; i < queues.size(); ++i) {
+      auto& victim = *queues[(self + i) % queues.size()];
+      ::std::lock_guard lock(victim.m);
+      if (!victim.tasks.empty()) {
+        t = ::std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void thread_pool::run(unsigned const self) {
+    detail::current_pool   = this;
+    detail::current_worker = self;
+
+    while (true) {
+      {
+        ::std::unique_lock lock(m);
+        work_available.wait(lock, [this]{ return queued || stopping; });
+        if (!queued && stopping)
+          return;
+        --queued;
+      }
+
+      // a task is reserved for us, it might just sit in another deque
+      task t;
+      while (!try_take(self, t))
+        ::std::this_thread::yield();
+
+      t();
+
+      bool done;
+      {
+        ::std::lock_guard lock(m);
+        done = --unfinished == 0;
+      }
+      if (done)
+        idle.notify_all();
+    }
+  }
+
+}
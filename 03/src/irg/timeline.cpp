@@ -0,0 +1,191 @@
+#include <irg/timeline.hpp>
+
+#include <cmath>
+#include <utility>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+
+namespace irg {
+
+  namespace {
+
+    // slope at key i, averaged over the keys around it
+    ::glm::vec3 tangent(::std::vector<keyframe> const& keys,
+                        ::std::size_t const i) {
+      auto const before = i ? i - 1 : i;
+      auto const after  = ::std::min(i + 1, keys.size() - 1);
+      auto const span   = keys[after].time - keys[before].time;
+      if (span <= 0.0)
+        return {0.0, 0.0, 0.0};
+      return (keys[after].value - keys[before].value)
+        * static_cast<float>(1.0 / span);
+    }
+
+    bool parse_interpolation(::std::string const& s, interpolation& mode) {
+      if (s == "linear")
+        mode = interpolation::linear;
+      else if (s == "bezier")
+        mode = interpolation::bezier;
+      else if (s == "catmull_rom")
+        mode = interpolation::catmull_rom;
+      else
+        return false;
+      return true;
+    }
+
+    // reads up to 3 numbers, returns how many
+    int read_values(::std::istringstream& in, ::glm::vec3& v) {
+      int count = 0;
+      float f;
+      while (count < 3 && in >> f)
+        v[count++] = f;
+      in.clear();
+      return count;
+    }
+
+  }
+
+  ::glm::vec3 track::sample(double const t) const noexcept {
+    if (keys.empty())
+      return {0.0, 0.0, 0.0};
+    if (t <= keys.front().time)
+      return keys.front().value;
+    if (t >= keys.back().time)
+      return keys.back().value;
+
+    auto const next = static_cast<::std::size_t>(::std::upper_bound(
+      keys.begin(), keys.end(), t,
+      [](double const t, keyframe const& k) { return t < k.time; }
+    ) - keys.begin());
+    auto const i = next - 1;
+
+    auto const& a = keys[i];
+    auto const& b = keys[next];
+    auto const h  = b.time - a.time;
+    auto const s  = static_cast<float>((t - a.time) / h);
+    auto const r  = 1.0f - s;
+
+    switch (a.mode) {
+      case interpolation::linear:
+        return a.value * r + b.value * s;
+      case interpolation::bezier:
+        return a.value * (r * r * r) + a.out * (3.0f * r * r * s)
+          + b.in * (3.0f * r * s * s) + b.value * (s * s * s);
+      case interpolation::catmull_rom: {
+        // cubic hermite, tangents scaled to the length of the segment
+        auto const scale = static_cast<float>(h);
+        auto const s2 = s * s;
+        auto const s3 = s2 * s;
+        return a.value * (2.0f * s3 - 3.0f * s2 + 1.0f)
+          + tangent(keys, i) * (scale * (s3 - 2.0f * s2 + s))
+          + b.value * (-2.0f * s3 + 3.0f * s2)
+          + tangent(keys, next) * (scale * (s3 - s2));
+      }
+    }
+    return a.value;
+  }
+
+  double timeline::duration() const noexcept {
+    double ret = 0.0;
+    for (auto const& [name, t] : tracks)
+      if (!t.keys.empty())
+        ret = ::std::max(ret, t.keys.back().time);
+    return ret;
+  }
+
+  double timeline::wrap(double const t) const noexcept {
+    auto const length = duration();
+    if (!loop || length <= 0.0)
+      return t;
+    return ::std::fmod(t, length);
+  }
+
+  void timeline::sample(::std::string const& name, double const t,
+                        float& value) const {
+    if (auto iter = tracks.find(name); iter != tracks.end())
+      value = iter->second.sample(wrap(t)).x;
+  }
+
+  void timeline::sample(::std::string const& name, double const t,
+                        ::glm::vec3& value) const {
+    if (auto iter = tracks.find(name); iter != tracks.end())
+      value = iter->second.sample(wrap(t));
+  }
+
+  ::std::optional<timeline> load_timeline(::std::string const& path,
+                                          ::std::string& error) {
+    ::std::ifstream file{path};
+    if (!file) {
+      error = "Unable to read timeline: " + path;
+      return {};
+    }
+
+    timeline ret;
+    ::std::string line;
+    for (int number = 1; ::std::getline(file, line); ++number) {
+      auto const fail = [&](char const* why) {
+        error = path + ":" + ::std::to_string(number) + ": " + why;
+      };
+
+      if (auto const comment = line.find('#'); comment != ::std::string::npos)
+        line.erase(comment);
+
+      ::std::istringstream in{line};
+      ::std::string name;
+      if (!(in >> name))
+        continue;
+      if (name == "loop") {
+        ret.loop = true;
+        continue;
+      }
+
+      keyframe key;
+      ::std::string mode;
+      if (!(in >> key.time >> mode))
+        return fail("expected <track> <time> <interpolation> <value>..."),
+               ::std::nullopt;
+      if (!parse_interpolation(mode, key.mode))
+        return fail("expected linear, bezier or catmull_rom"), ::std::nullopt;
+
+      auto const components = read_values(in, key.value);
+      if (components != 1 && components != 3)
+        return fail("expected 1 or 3 values"), ::std::nullopt;
+
+      key.in = key.out = key.value;
+      for (::std::string handle; in >> handle;) {
+        auto& target = handle == "in" ? key.in : key.out;
+        if ((handle != "in" && handle != "out")
+            || read_values(in, target) != components)
+          return fail("expected in or out and as many values as the key"),
+                 ::std::nullopt;
+      }
+
+      auto& t = ret.tracks[name];
+      if (t.keys.empty())
+        t.components = components;
+      else if (t.components != components)
+        return fail("keys of a track need the same number of values"),
+               ::std::nullopt;
+      if (!t.keys.empty() && key.time <= t.keys.back().time)
+        return fail("keys of a track need increasing times"), ::std::nullopt;
+
+      t.keys.push_back(key);
+    }
+
+    return ret;
+  }
+
+  double timeline_clock::tick() noexcept {
+    if (!::std::exchange(started, true)) {
+      start = clock::now();
+      return current;
+    }
+
+    current = fixed()
+      ? current + step
+      : ::std::chrono::duration<double>(clock::now() - start).count();
+    return current;
+  }
+
+}
@@ -0,0 +1,173 @@
+#include <irg/timing.hpp>
+
+#include <algorithm>
+
+#include <glad/glad.h>
+
+namespace irg {
+
+  namespace {
+
+    // nearest rank, the smallest sample with at least q of them at or below
+    constexpr ::std::size_t rank_of(double const q, ::std::size_t const n) {
+      auto const exact = q * n;
+      auto rank = static_cast<::std::size_t>(exact);
+      if (rank < exact)
+        ++rank;
+      return rank ? ::std::min(rank, n) - 1 : 0;
+    }
+
+    static_assert(rank_of(0.99, 3) == 2);
+    static_assert(rank_of(0.50, 3) == 1);
+    static_assert(rank_of(0.99, 240) == 237);
+
+    percentiles percentiles_of(::std::deque<double> const& times) {
+      if (times.empty())
+        return {};
+
+      ::std::vector<double> sorted(times.begin(), times.end());
+      ::std::sort(sorted.begin(), sorted.end());
+
+      auto at = [&](double const q) {
+        return sorted[rank_of(q, sorted.size())];
+      };
+
+      return {at(0.50), at(0.95), at(0.99)};
+    }
+
+    void push_limited(::std::deque<double>& times, double const t,
+                      ::std::size_t const limit) {
+      times.push_back(t);
+      while (times.size() > limit)
+        times.pop_front();
+    }
+
+  }
+
+  frame_timer::frame_timer(::std::size_t const window,
+                           ::std::size_t const query_count)
+    : window(window ? window : 1)
+    , queries(query_count)
+    , busy(query_count, false)
+    , current(query_count)
+  {
+    if (!queries.empty())
+      glGenQueries(queries.size(), queries.data());
+  }
+
+  frame_timer::~frame_timer() {
+    if (!queries.empty())
+      glDeleteQueries(queries.size(), queries.data());
+  }
+
+  bool frame_timer::open_csv(char const* path) {
+    csv = {::std::fopen(path, "w"), ::std::fclose};
+    if (!csv)
+      return false;
+
+    ::std::fputs(
+      "frame,cpu_ms,gpu_ms,width,height,iterations,max_steps,min_distance,"
+      "hit_footprint,power,camera_x,camera_y,camera_z,target_x,target_y,"
+      "target_z\n",
+      csv.get());
+    return true;
+  }
+
+  void frame_timer::begin() {
+    poll(false);
+
+    frame_start = clock::now();
+    // with every query still in flight the frame goes without GPU time
+    current = queries.size();
+    if (!queries.empty() && !busy[next_slot]) {
+      current = next_slot;
+      next_slot = (next_slot + 1) % queries.size();
+
+      busy[current] = true;
+      glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+    }
+  }
+
+  void frame_timer::end(frame_parameters const& parameters) {
+    if (current != queries.size())
+      glEndQuery(GL_TIME_ELAPSED);
+
+    frame_sample sample;
+    sample.frame  = frames++;
+    sample.cpu_ms = ::std::chrono::duration<double, ::std::milli>(
+      clock::now() - frame_start).count();
+    sample.parameters = parameters;
+
+    pending.push_back({sample, current});
+    current = queries.size();
+  }
+
+  void frame_timer::flush() {
+    poll(true);
+  }
+
+  void frame_timer::poll(bool const wait) {
+    while (!pending.empty()) {
+      auto& front = pending.front();
+
+      if (front.slot != queries.size()) {
+        auto const query = queries[front.slot];
+
+        if (!wait) {
+          int available = 0;
+          glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+          // later queries can not be done before this one
+          if (!available)
+            return;
+        }
+
+        ::GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+        front.sample.gpu_ms = elapsed / 1e6;
+        busy[front.slot] = false;
+      }
+
+      record(front.sample);
+      pending.pop_front();
+    }
+  }
+
+  void frame_timer::record(frame_sample const& s) {
+    ++recorded;
+    push_limited(cpu_times, s.cpu_ms, window);
+    if (s.gpu_ms >= 0.0)
+      push_limited(gpu_times, s.gpu_ms, window);
+
+    if (!csv)
+      return;
+
+    auto const& p = s.parameters;
+    ::std::fprintf(csv.get(),
+      "%llu,%.4f,%.4f,%d,%d,%d,%d,%g,%g,%g,%g,%g,%g,%g,%g,%g\n",
+      static_cast<unsigned long long>(s.frame), s.cpu_ms, s.gpu_ms,
+      p.width, p.height, p.iterations, p.max_steps, p.min_distance,
+      p.hit_footprint, p.power,
+      p.camera_position.x, p.camera_position.y, p.camera_position.z,
+      p.camera_target.x, p.camera_target.y, p.camera_target.z);
+  }
+
+  percentiles frame_timer::cpu() const {
+    return percentiles_of(cpu_times);
+  }
+
+  percentiles frame_timer::gpu() const {
+    return percentiles_of(gpu_times);
+  }
+
+  void frame_timer::print_summary(::std::ostream& out) const {
+    auto const c = cpu();
+    auto const g = gpu();
+
+    out << "frames: " << recorded
+        << ", cpu ms p50/p95/p99: "
+        << c.p50 << "/" << c.p95 << "/" << c.p99
+        << ", gpu ms p50/p95/p99: "
+        << g.p50 << "/" << g.p95 << "/" << g.p99 << "\n";
+  }
+
+}
@@ -0,0 +1,124 @@
+#include <irg/variants.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <algorithm>
+
+namespace irg {
+
+  namespace {
+
+    ::std::string key_of(defines const& d) {
+      ::std::string key;
+      for (auto const& [name, value] : d)
+        key += name + "=" + value + "\n";
+      return key;
+    }
+
+  }
+
+  ::std::string glsl_float(float const f) {
+    char buffer[32];
+    ::std::snprintf(buffer, sizeof(buffer), "%.9g", f);
+
+    ::std::string literal{buffer};
+    if (literal.find_first_of(".e") == ::std::string::npos)
+      literal += ".0";
+    return literal;
+  }
+
+  program_variants::program_variants(program_sources generic_sources,
+                                     shader_program const& generic,
+                                     background_compiler& compiler)
+    : compiler(compiler)
+  {
+    reset(::std::move(generic_sources), generic);
+  }
+
+  void program_variants::reset(program_sources sources,
+                               shader_program const& program) {
+    generic_sources = ::std::move(sources);
+    generic = program;
+
+    variants.clear();
+    building.clear();
+    current.clear();
+    started = false;
+  }
+
+  void program_variants::request(shader_program& program, defines const& d) {
+    auto key = key_of(d);
+    if (started && key == requested)
+      return;
+
+    started   = true;
+    requested = ::std::move(key);
+
+    auto const cached = ::std::find_if(
+      variants.begin(), variants.end(),
+      [this](auto const& v) { return v.key == requested; });
+
+    if (requested.empty() || cached != variants.end()) {
+      use(program, requested);
+      return;
+    }
+
+    if (!building.count(requested))
+      building.emplace(requested, compiler.submit({
+        generic_sources.vertex,
+        shader::inject_defines(generic_sources.fragment, d),
+      }));
+
+    use(program, {});
+    // builds on the calling thread are already done
+    poll(program);
+  }
+
+  void program_variants::poll(shader_program& program) {
+    for (auto i = building.begin(); i != building.end();) {
+      if (i->second.wait_for(::std::chrono::seconds{0})
+            != ::std::future_status::ready) {
+        ++i;
+        continue;
+      }
+
+      auto result = i->second.get();
+      if (result.program) {
+        variants.push_front({i->first, *result.program});
+        if (variants.size() > capacity)
+          variants.pop_back();
+      } else {
+        ::std::cerr << "Unable to build a specialized program, "
+                    << "staying with the generic one:\n" << result.log << "\n";
+      }
+
+      i = building.erase(i);
+    }
+
+    if (requested != current)
+      if (::std::any_of(variants.begin(), variants.end(),
+                        [this](auto const& v) { return v.key == requested; }))
+        use(program, requested);
+  }
+
+  void program_variants::use(shader_program& program,
+                             ::std::string const& key) {
+    if (key == current)
+      return;
+
+    if (key.empty()) {
+      program.replace(*generic);
+    } else {
+      auto const v = ::std::find_if(
+        variants.begin(), variants.end(),
+        [&key](auto const& v) { return v.key == key; });
+      // most recently used first
+      variants.splice(variants.begin(), variants, v);
+      program.replace(v->program);
+    }
+
+    current = key;
+  }
+
+}
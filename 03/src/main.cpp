@@ -1,4 +1,14 @@
+#include <cmath>
+#include <chrono>
 #include <cstdio>
+#include <string>
+#include <vector>
+#include <optional>
+#include <tuple>
+#include <algorithm>
+#include <filesystem>
+#include <cstring>
+#include <cstdlib>
 #include <iostream>
 
 #include <irg/common.hpp>
@@ -6,117 +16,475 @@
 #include <irg/keyboard.hpp>
 #include <irg/window.hpp>
 #include <irg/camera.hpp>
+#include <irg/headless.hpp>
+#include <irg/framebuffer.hpp>
+#include <irg/progressive.hpp>
+#include <irg/timing.hpp>
+#include <irg/march_cost.hpp>
+#include <irg/reload.hpp>
+#include <irg/variants.hpp>
+#include <irg/library.hpp>
+#include <irg/timeline.hpp>
+#include <irg/capture.hpp>
 
 int main(int const argc, char const* const* argv) {
-  if (argc != 2) {
+  bool valid_arguments = true;
+  ::std::vector<::std::string> shader_paths;
+  bool headless = false;
+  char const* output_prefix = nullptr;
+  char const* csv_path = nullptr;
+  char const* cost_prefix = nullptr;
+  char const* timeline_path = nullptr;
+  // rendered frames are also read back and encoded here
+  ::std::optional<::irg::capture_target> capture_target;
+
+  auto initial_width = 400;
+  auto initial_height = 400;
+  auto frames = 0;
+  // the power of the mandelbulb grows over time unless one is given
+  ::std::optional<float> fixed_power;
+  // hit threshold in pixels, see hit_footprint below
+  ::std::optional<float> footprint;
+  // vertical field of view in degrees
+  ::std::optional<float> fov;
+  // animations advance by 1 / fps per frame, headless and captured frames
+  // always do
+  ::std::optional<double> fps;
+
+  for (int i = 1; i < argc; ++i) {
+    if (!::std::strcmp(argv[i], "--headless") && i + 3 < argc) {
+      headless = true;
+      if (::std::sscanf(argv[++i], "%dx%d", &initial_width, &initial_height) 
+            != 2 || initial_width <= 0 || initial_height <= 0)
+        ::irg::terminate("Expected headless resolution as <width>x<height>.");
+      if ((frames = ::std::atoi(argv[++i])) <= 0)
+        ::irg::terminate("Expected a positive number of headless frames.");
+      output_prefix = argv[++i];
+    } else if (!::std::strcmp(argv[i], "--csv") && i + 1 < argc) {
+      csv_path = argv[++i];
+    } else if (!::std::strcmp(argv[i], "--cost") && i + 1 < argc) {
+      cost_prefix = argv[++i];
+    } else if (!::std::strcmp(argv[i], "--power") && i + 1 < argc) {
+      fixed_power = static_cast<float>(::std::atof(argv[++i]));
+    } else if (!::std::strcmp(argv[i], "--footprint") && i + 1 < argc) {
+      footprint = static_cast<float>(::std::atof(argv[++i]));
+    } else if (!::std::strcmp(argv[i], "--fov") && i + 1 < argc) {
+      fov = static_cast<float>(::std::atof(argv[++i]));
+      if (*fov <= 0.0f || *fov >= 180.0f)
+        ::irg::terminate("Expected a field of view between 0 and 180 degrees.");
+    } else if (!::std::strcmp(argv[i], "--timeline") && i + 1 < argc) {
+      timeline_path = argv[++i];
+    } else if (!::std::strcmp(argv[i], "--capture") && i + 1 < argc) {
+      if (!::irg::parse_capture_target(
+            argv[++i], capture_target.emplace()))
+        ::irg::terminate(
+          "Expected capture as png:<prefix>, y4m:<path>, pipe:<command>, "
+          "gif:<path> or gif-global:<path>.");
+    } else if (!::std::strcmp(argv[i], "--fps") && i + 1 < argc) {
+      if ((fps = ::std::atof(argv[++i])) <= 0.0)
+        ::irg::terminate("Expected a positive animation frame rate.");
+    } else if (!::std::strncmp(argv[i], "--", 2)) {
+      valid_arguments = false;
+      break;
+    } else if (::std::filesystem::is_directory(argv[i])) {
+      ::std::vector<::std::string> found;
+      for (auto const& entry : ::std::filesystem::directory_iterator(argv[i]))
+        if (entry.path().extension() == ".glsl")
+          found.push_back(entry.path().string());
+      ::std::sort(found.begin(), found.end());
+      shader_paths.insert(shader_paths.end(), found.begin(), found.end());
+    } else {
+      shader_paths.push_back(argv[i]);
+    }
+  }
+
+  if (!valid_arguments || shader_paths.empty()) {
     ::irg::terminate(
-      "Expected one command line argument: <fragment shader path>\n"
+      "Expected command line arguments: "
+      "<fragment shader paths or directories>... "
+      "[--headless <width>x<height> <frames> "
+      "<output prefix, unused with --capture>] "
+      "[--csv <frame timings path>] [--cost <march cost prefix>] "
+      "[--power <fixed mandelbulb power>] "
+      "[--footprint <hit threshold in pixels, 0 for min_distance>] "
+      "[--fov <vertical field of view in degrees>] "
+      "[--timeline <keyframe file>] [--fps <animation frames per second>] "
+      "[--capture <png:<prefix>|y4m:<path>|pipe:<command>|gif:<path>|"
+      "gif-global:<path>>]\n"
       "See 'data/shaders' folder of this repository.");
   }
 
-  auto const initial_width = 400;
-  auto const initial_height = 400;
-  auto  guard  = ::irg::init();
-  auto* window = ::irg::create_window(initial_width, initial_height);
+  auto  guard  = headless ? ::irg::init_headless() : ::irg::init();
+  auto* window = 
+    headless ? nullptr : ::irg::create_window(initial_width, initial_height);
+
+  if (window)
+    ::irg::bind_events(window);
+
+  char const* const vertex_source =
+    "#version 330 core\n"
+    "layout (location = 0) in vec2 pos;\n"
+    "void main(){ gl_Position = vec4(pos, 0.0, 1.0); }";
 
-  ::irg::bind_events(window);
+  // linked programs are kept on disk, restarts skip the compile
+  ::irg::program_cache::open(::irg::program_cache::default_directory());
 
-  ::irg::shader_program shader{
-    {"#version 330 core\n"
-     "layout (location = 0) in vec2 pos;\n"
-     "void main(){ gl_Position = vec4(pos, 0.0, 1.0); }", 
-     GL_VERTEX_SHADER},
-    ::irg::shader::from_file(argv[1], GL_FRAGMENT_SHADER)
+  // programs are built by the driver's threads or on shared contexts
+  ::irg::background_compiler compiler{
+    !headless, []{ ::glfwPostEmptyEvent(); }};
+
+  // every fractal is built up front, switching between them is instant
+  ::irg::fractal_library library{shader_paths, vertex_source, compiler};
+  ::irg::shader_program shader{library.program()};
+
+  // edits of the active fractal are compiled in the background
+  ::std::optional<::irg::shader_reloader> reloader;
+  auto const watch_active = [&]{
+    if (compiler.asynchronous())
+      reloader.emplace(
+        library.path(library.active()), vertex_source, compiler);
   };
+  watch_active();
 
   ::irg::camera camera{{0, 0, -2}, {0, 0, 0}};
+  if (fov)
+    camera.fov = ::glm::radians(*fov);
   ::irg::k_events.add_listener(::irg::standard_camera_controler(camera));
 
+  // the second attachment keeps hit distances for reprojection, the third
+  // the march cost of every pixel
+  ::std::vector<unsigned> const formats{GL_RGBA8, GL_R32F, GL_RGBA32UI};
+  ::std::size_t constexpr cost_attachment = 2;
+  ::irg::progressive_resolution progressive{
+    initial_width, initial_height, formats};
+
   shader.activate();
-  shader.set_uniform_vec3("resolution", {
+
+  // parameters of the frame, uploaded once per march into the block every
+  // program reads them from
+  ::irg::frame_uniforms uniforms;
+  ::irg::uniform_buffer<::irg::frame_uniforms> uniform_block{
+    ::irg::frame_uniforms::binding};
+  uniforms.resolution = {
     static_cast<float>(initial_width), 
     static_cast<float>(initial_height),
     0.f,
-  });
+  };
 
   int iterations = 8;
   int max_steps = 64;
   float min_distance = 0.001;
-  shader.set_uniform_int("iterations", iterations);
-  shader.set_uniform_int("max_steps", max_steps);
-  shader.set_uniform_float("min_distance", min_distance);
 
-  auto const update_camera = [&camera, &shader]{
-    camera.update();
-    shader.set_uniform_vec3("camera_position", camera.position);
-    shader.set_uniform_vec3("camera_target", camera.target);
+  // Hits within a fraction of a pixel instead of min_distance, which is
+  // the default while flying around. Headless frames keep the fixed
+  // threshold unless --footprint is given.
+  float const default_footprint = 0.25;
+  float hit_footprint = headless ? footprint.value_or(0.0f)
+                                 : footprint.value_or(default_footprint);
+
+  // over-relaxed steps, 1 marches plainly
+  float const relaxed_omega = 1.4;
+  float relaxation = 1.0;
+
+  float power = fixed_power.value_or(4.0);
+  // without a power track the power grows by this fraction per second
+  double power_growth = fixed_power ? 0.0 : 0.03;
+
+  // keyframed parameters and camera, sampled once per frame
+  ::irg::timeline timeline;
+  if (timeline_path) {
+    ::std::string error;
+    if (auto loaded = ::irg::load_timeline(timeline_path, error); loaded)
+      timeline = ::std::move(*loaded);
+    else
+      ::irg::terminate(error.c_str());
+  }
+
+  // wall clock while flying around, fixed steps for offline renders and
+  // captures
+  ::irg::timeline_clock clock{
+    fps ? 1.0 / *fps : headless || capture_target ? 1.0 / 60.0 : 0.0};
+  double animation_time = 0.0;
+
+  // headless renders of several fractals play the animation from the start
+  // for every one of them
+  auto const initial = ::std::make_tuple(
+    camera.position, camera.target, camera.fov, power, iterations, max_steps,
+    min_distance, hit_footprint, relaxation);
+  auto const rewind = [&]{
+    ::std::tie(
+      camera.position, camera.target, camera.fov, power, iterations,
+      max_steps, min_distance, hit_footprint, relaxation) = initial;
+    clock.restart();
+    animation_time = 0.0;
   };
 
-  update_camera();
+  // moves the animated parameters to the time of the next frame
+  auto const animate = [&]{
+    auto const t = clock.tick();
+    if (power_growth != 0.0 && !timeline.has("power"))
+      power *= static_cast<float>(
+        ::std::exp(power_growth * (t - animation_time)));
+    animation_time = t;
 
-  
+    if (timeline.tracks.empty())
+      return;
 
+    timeline.sample("camera.position", t, camera.position);
+    timeline.sample("camera.target", t, camera.target);
+    if (timeline.has("camera.fov")) {
+      float degrees = 0.0;
+      timeline.sample("camera.fov", t, degrees);
+      camera.fov = ::glm::radians(::std::clamp(degrees, 1.0f, 179.0f));
+    }
+
+    timeline.sample("power", t, power);
+    timeline.sample("min_distance", t, min_distance);
+    timeline.sample("hit_footprint", t, hit_footprint);
+    timeline.sample("relaxation", t, relaxation);
+
+    // integer parameters take the nearest value
+    auto const sample_int = [&](char const* name, int& value) {
+      auto f = static_cast<float>(value);
+      timeline.sample(name, t, f);
+      value = ::std::max(1, static_cast<int>(::std::lround(f)));
+    };
+    sample_int("iterations", iterations);
+    sample_int("max_steps", max_steps);
 
-  float power = 4.0;
-  float power_delta = 1.0005;
-  shader.set_uniform_float("power", power);
+    // anything else is a uniform of the shader itself
+    for (auto const& [name, track] : timeline.tracks) {
+      if (name.rfind("camera.", 0) == 0 || name == "power"
+          || name == "min_distance" || name == "hit_footprint"
+          || name == "relaxation" || name == "iterations"
+          || name == "max_steps")
+        continue;
+
+      auto const value = track.sample(t);
+      if (track.components == 1)
+        shader.set_uniform_float(name.c_str(), value.x);
+      else
+        shader.set_uniform_vec3(name.c_str(), value);
+    }
+  };
+
+  // everything but the resolution and the previous camera, which follow
+  // the march and so never make a frame stale
+  auto const fill_uniforms = [&]{
+    // rays are built from a basis computed on the CPU
+    uniforms.camera        = camera.ray_basis();
+    uniforms.power         = power;
+    uniforms.iterations    = iterations;
+    uniforms.max_steps     = max_steps;
+    uniforms.min_distance  = min_distance;
+    uniforms.hit_footprint = hit_footprint;
+    uniforms.relaxation    = relaxation;
+  };
+
+  // reprojection reuses hit distances of the previous frame while moving
+  bool reprojection = true;
+  // whether the previous frame was marched with the current parameters
+  bool history = false;
+  ::glm::mat4 previous_basis = camera.ray_basis();
+  // distances marched with another power or iteration count, as timelines
+  // and the growing power change them, are of another surface
+  float previous_power = power;
+  int previous_iterations = iterations;
+
+  auto const reproject = shader.uniform("reproject");
+  shader.set_uniform_int("previous_distance", 0);
+
+  // low resolution prepass marching one cone per block of pixels, its cost
+  // is written to the attachment the march targets keep theirs in
+  bool cone_prepass = true;
+  int const cone_block = 8;
+  ::std::vector<unsigned> const cone_formats{GL_RG32F, GL_R32F, GL_RGBA32UI};
+  ::std::optional<::irg::framebuffer> cone_target;
+  // whether the cones belong to the latest march
+  bool cones_marched = false;
+
+  auto const cone_pass  = shader.uniform("cone_pass");
+  auto const cone_start = shader.uniform("cone_start");
+  shader.set_uniform_int("cone_block", cone_block);
+  shader.set_uniform_int("cone_distance", 1);
+
+  // cpu and gpu time of every drawn frame
+  ::irg::frame_timer timer;
+  if (csv_path && !timer.open_csv(csv_path))
+    ::std::cerr << "Error while opening file: ", ::irg::terminate(csv_path);
+
+  // Read back without stalling and encoded on a pool, one frame per
+  // timeline step. Headless frames go here instead of the PPM files, with
+  // several fractals each one is a clip of its own.
+  ::std::optional<::irg::frame_writer> writer;
+  ::std::optional<::irg::frame_capture> capture;
+  auto const clips = headless && library.size() > 1;
+
+  auto const open_capture = [&](::irg::capture_target const& target) {
+    writer.emplace(target, fps.value_or(60.0));
+    if (!writer->open())
+      ::std::cerr << "Error while opening capture: ",
+      ::irg::terminate(target.destination.c_str());
+    capture.emplace(*writer);
+  };
+
+  auto const finish_capture = [&]{
+    if (!capture)
+      return;
+    capture->flush();
+    capture.reset();
+    if (!writer->finish())
+      ::irg::terminate("Capture incomplete.");
+    ::std::cout << "frames captured: " << writer->written() << "\n";
+    writer.reset();
+  };
+
+  if (capture_target && clips
+      && capture_target->kind == ::irg::capture_target::format::pipe)
+    ::irg::terminate(
+      "A pipe can not capture several fractals, render them one by one.");
+  if (capture_target && !clips)
+    open_capture(*capture_target);
+
+  bool print_timing = true;
+  auto last_summary = ::std::chrono::steady_clock::now();
+
+  // heatmap of the march cost over the image
+  bool show_cost = false;
+  ::irg::cost_overlay overlay;
+  int cost_dumps = 0;
+
+  // writes the cost statistics and heatmap of a target as <prefix>.csv/.ppm
+  auto const dump_cost = [&](::irg::framebuffer const& source, 
+                             ::std::string const& prefix) {
+    ::irg::march_cost cost;
+    ::irg::read_march_cost(source, cost_attachment, cost);
+    ::irg::march_cost cones;
+    if (cones_marched)
+      ::irg::read_march_cost(*cone_target, cost_attachment, cones);
+    auto const stats = ::irg::reduce(cost, cones_marched ? &cones : nullptr);
+
+    ::irg::image heat;
+    ::irg::heatmap(cost, max_steps, heat);
+
+    if (auto path = prefix + ".csv"; 
+        !::irg::write_statistics(path.c_str(), stats))
+      ::std::cerr << "Error while writing file: ",
+      ::irg::terminate(path.c_str());
+    if (auto path = prefix + ".ppm"; !::irg::write_ppm(path.c_str(), heat))
+      ::std::cerr << "Error while writing file: ",
+      ::irg::terminate(path.c_str());
+
+    ::std::cout << "march cost written to: " << prefix << ".csv/.ppm\n";
+  };
 
   ::irg::k_events.add_listener([&](auto key, bool released) {
     if (released) {
       return ::irg::ob::remain;
     }
-    auto constexpr static delta = 0.0001;
+    if (key >= GLFW_KEY_3 && key <= GLFW_KEY_8) {
+      history = false;
+    }
+    auto constexpr static delta = 0.006;
     if (key == GLFW_KEY_0) {
-      power_delta = 1.0;
-      ::std::cout << "power_delta: " << power_delta << "\n";
+      power_growth = 0.0;
+      ::std::cout << "power growth per second: " << power_growth << "\n";
     } else if (key == GLFW_KEY_1) {
-      power_delta += delta;
-      ::std::cout << "power_delta: " << power_delta << "\n";
+      power_growth += delta;
+      ::std::cout << "power growth per second: " << power_growth << "\n";
     } else if (key == GLFW_KEY_2) {
-      power_delta -= delta;
-      ::std::cout << "power_delta: " << power_delta << "\n";
+      power_growth -= delta;
+      ::std::cout << "power growth per second: " << power_growth << "\n";
     } else if (key == GLFW_KEY_3) {
-      shader.set_uniform_int("iterations", ++iterations);
+      ++iterations;
       ::std::cout << "iterations: " << iterations << "\n";
     } else if (key == GLFW_KEY_4) {
-      shader.set_uniform_int("iterations", --iterations);
+      --iterations;
       ::std::cout << "iterations: " << iterations << "\n";
     } else if (key == GLFW_KEY_5) {
-      shader.set_uniform_int("max_steps", max_steps *= 2);
+      max_steps *= 2;
       ::std::cout << "max steps: " << max_steps << "\n";
     } else if (key == GLFW_KEY_6) {
       max_steps /= 2;
       if (!max_steps) max_steps = 1;
-      shader.set_uniform_int("max_steps", max_steps);
       ::std::cout << "max steps: " << max_steps << "\n";
+    } else if (key == GLFW_KEY_7 && hit_footprint > 0.0f) {
+      hit_footprint *= 2.0;
+      ::std::cout << "hit footprint: " << hit_footprint << "\n";
+    } else if (key == GLFW_KEY_8 && hit_footprint > 0.0f) {
+      hit_footprint /= 2.0;
+      ::std::cout << "hit footprint: " << hit_footprint << "\n";
     } else if (key == GLFW_KEY_7) {
-      shader.set_uniform_float("min_distance", min_distance *= 10.0);
+      min_distance *= 10.0;
       ::std::cout << "min_distance: " << min_distance << "\n";
     } else if (key == GLFW_KEY_8) {
-      shader.set_uniform_float("min_distance", min_distance /= 10.0);
+      min_distance /= 10.0;
       ::std::cout << "min_distance: " << min_distance << "\n";
+    } else if (key == GLFW_KEY_F) {
+      hit_footprint = hit_footprint > 0.0f ? 0.0f : default_footprint;
+      ::std::cout << "hit footprint: " << hit_footprint << "\n";
+    } else if (key == GLFW_KEY_9) {
+      progressive.max_scale = progressive.max_scale > 1.0f ? 1.0f : 2.0f;
+      ::std::cout << "still frame scale: " << progressive.max_scale << "\n";
+    } else if (key == GLFW_KEY_C) {
+      cone_prepass = !cone_prepass;
+      ::std::cout << "cone prepass: " << cone_prepass << "\n";
+    } else if (key == GLFW_KEY_E) {
+      relaxation = relaxation > 1.0f ? 1.0f : relaxed_omega;
+      ::std::cout << "step relaxation: " << relaxation << "\n";
+    } else if (key == GLFW_KEY_T) {
+      print_timing = !print_timing;
+      ::std::cout << "frame timing summary: " << print_timing << "\n";
+    } else if (key == GLFW_KEY_H) {
+      show_cost = !show_cost;
+      ::irg::invalidate();
+      ::std::cout << "march cost heatmap: " << show_cost << "\n";
+    } else if (key == GLFW_KEY_M && progressive.current()) {
+      char index[16];
+      ::std::snprintf(index, sizeof(index), "%04d", cost_dumps++);
+      dump_cost(*progressive.current(), "march_cost_" + ::std::string{index});
+    } else if (key == GLFW_KEY_R) {
+      reprojection = !reprojection;
+      ::std::cout << "reprojection: " << reprojection << "\n";
+    } else if (key == GLFW_KEY_N) {
+      library.select((library.active() + 1) % library.size());
+    } else if (key == GLFW_KEY_P) {
+      library.select(
+        (library.active() + library.size() - 1) % library.size());
+    } else if (key >= GLFW_KEY_F1 && key <= GLFW_KEY_F12) {
+      library.select(static_cast<::std::size_t>(key - GLFW_KEY_F1));
     }
     return ::irg::ob::remain;
   });
 
-  ::std::cout 
+  if (!headless) ::std::cout 
     << "3D fractals with Ray Marching by https://github.com/yatsukha/" << "\n\n"
     << "Use WASD to rotate camera around target, IO to zoom in/out." << "\n"
     << "Use arrow keys to move the camera target, JK to zoom in/out." << "\n"
-    << "0 to reset power increase/decrease for Mandelbulb." << "\n"
-    << "1/2 to increase/decrease power change for Mandelbulb." << "\n"
+    << "0 to stop the power growth of the Mandelbulb." << "\n"
+    << "1/2 to speed up/slow down the power growth of the Mandelbulb." << "\n"
     << "3/4 to increase/decrease iteration count for fractals." << "\n"
     << "5/6 to increase/decrease the max number of ray march steps." << "\n"
-    << "7/8 to increase/decrease minimum distance required for a hit."
+    << "7/8 to increase/decrease minimum distance required for a hit." << "\n"
+    << "F to toggle hits within a quarter pixel instead, 7/8 then scale it."
+    << "\n"
+    << "9 to toggle 2x supersampling once the camera stops." << "\n"
+    << "R to toggle reuse of the previous frame while the camera moves." << "\n"
+    << "C to toggle the cone marching prepass." << "\n"
+    << "E to toggle over-relaxed ray march steps." << "\n"
+    << "T to toggle the periodic frame timing summary." << "\n"
+    << "H to toggle the march cost heatmap, M to write it to a file." << "\n"
+    << "N/P to switch to the next/previous fractal, F1-F12 to pick one."
     << ::std::endl;
+
+  if (!headless && library.size() > 1)
+    for (::std::size_t i = 0; i < library.size(); ++i)
+      ::std::cout << "F" << i + 1 << ": " << library.name(i) << "\n";
     
 
-  ::irg::w_events.add_listener([&shader](auto const w, auto const h) {
-    shader.activate();
-    shader.set_uniform_vec3(
-      "resolution",
-      {static_cast<float>(w), static_cast<float>(h), 0.f}
-    );
+  ::irg::w_events.add_listener([&](auto const w, auto const h) {
+    progressive.resize(w, h);
+    history = false;
     return ::irg::ob::remain;
   });
 
@@ -158,20 +526,225 @@ int main(int const argc, char const* const* argv) {
 
   glEnable(GL_DEPTH_TEST);
 
-  ::irg::window_loop(window, [&]{
-    glClearColor(0.0f, 0.0f, 0.0f, 1.f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  // camera flown by the timeline, which counts as moving until it ends
+  auto const moving = [&]{
+    auto const flown = timeline.has("camera.position")
+      || timeline.has("camera.target") || timeline.has("camera.fov");
+    return camera.moving()
+      || (flown && (timeline.loop || animation_time < timeline.duration()));
+  };
+
+  auto const animating = [&]{
+    return timeline.has("power") || ::std::abs(power_growth) > 1e-9;
+  };
+
+  // Animated parameters would need a new program every frame, they are
+  // left to the uniforms instead.
+  auto const specialization = [&]{
+    ::irg::defines d;
+    auto const bake = [&](char const* track, char const* name,
+                          ::std::string value) {
+      if (!timeline.has(track))
+        d.emplace_back(name, ::std::move(value));
+    };
+    bake("iterations", "ITERATIONS", ::std::to_string(iterations));
+    bake("max_steps", "MAX_STEPS", ::std::to_string(max_steps));
+    bake("min_distance", "MIN_DISTANCE", ::irg::glsl_float(min_distance));
+    bake("hit_footprint", "HIT_FOOTPRINT", ::irg::glsl_float(hit_footprint));
+    bake("relaxation", "RELAXATION", ::irg::glsl_float(relaxation));
+    if (!animating())
+      d.emplace_back("POWER", ::irg::glsl_float(power));
+    return d;
+  };
+
+  // moves the scene forward, true if the last frame is out of date
+  auto const update = [&]{
+    // the driver does not tell when a parallel build is done
+    if (compiler.poll())
+      ::irg::wake_soon();
+
+    if (reloader)
+      if (auto next = reloader->take(); next) {
+        library.reload(shader, ::std::move(*next));
+        history = false;
+      }
 
-    update_camera();
-    if (::std::abs(power_delta - 1.0) > 1e-6) {
-      power *= power_delta;
-      shader.set_uniform_float("power", power);
+    auto const previous = library.active();
+    library.poll(shader);
+    if (library.active() != previous) {
+      // the distances of another fractal are no use for reprojection
+      history = false;
+      watch_active();
+      ::std::cout << "fractal: " << library.name(library.active()) << "\n";
     }
 
+    camera.update();
+    animate();
+    if (power != previous_power || iterations != previous_iterations)
+      history = false;
+
+    library.request(shader, specialization());
+
+    fill_uniforms();
+    auto const changed = shader.take_changes();
+    return uniform_block.differs(uniforms) || changed;
+  };
+
+  // Picks the resolution of the next frame, lowered while the camera moves.
+  // Captures march every step of the clock once, in full resolution.
+  auto const update_progressive = [&]{
+    auto const changed = update();
+    if (!progressive.advance(changed || capture, moving() && !capture))
+      return false;
+
+    // following the scale is not a change of the scene, the march uploads
+    // it
+    auto const r = progressive.resolution();
+    uniforms.resolution = {
+      static_cast<float>(r.x), static_cast<float>(r.y), 0.f};
+    return true;
+  };
+
+  auto const draw_quad = [&]{
     glBindVertexArray(VAO);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+  };
+
+  // marches the cones of the target and binds their start distances
+  auto const march_cones = [&](::irg::framebuffer const& target) {
+    shader.set_uniform_int(cone_start, cone_prepass);
+    cones_marched = cone_prepass;
+    if (!cone_prepass)
+      return;
+
+    auto const width  = (target.width + cone_block - 1) / cone_block;
+    auto const height = (target.height + cone_block - 1) / cone_block;
+    if (!cone_target 
+        || cone_target->width != width || cone_target->height != height)
+      cone_target.emplace(width, height, cone_formats);
+
+    cone_target->bind();
+    shader.set_uniform_int(cone_pass, true);
+    draw_quad();
+    shader.set_uniform_int(cone_pass, false);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, cone_target->texture());
+    target.bind();
+  };
+
+  auto const march = [&](::irg::framebuffer const& target,
+                         ::irg::framebuffer const* previous) {
+    // still and captured frames are always marched in full
+    auto const reuse = 
+      reprojection && history && previous && moving() && !capture;
+
+    shader.set_uniform_int(reproject, reuse);
+    if (reuse) {
+      glActiveTexture(GL_TEXTURE0);
+      glBindTexture(GL_TEXTURE_2D, previous->texture(1));
+    }
+    uniforms.previous_camera = previous_basis;
+    uniform_block.upload(uniforms);
+
+    march_cones(target);
+
+    glClearColor(0.0f, 0.0f, 0.0f, 1.f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    draw_quad();
 
     ::irg::assert_no_error();
-  });
 
+    previous_basis = uniforms.camera;
+    previous_power = power;
+    previous_iterations = iterations;
+    history = true;
+    // uploads made by the march itself do not make the frame stale
+    shader.take_changes();
+  };
+
+  auto const timed = [&](auto const& draw, ::glm::ivec2 const r) {
+    timer.begin();
+    draw();
+    timer.end({
+      r.x, r.y, iterations, max_steps, min_distance, hit_footprint, power, 
+      camera.position, camera.target,
+    });
+  };
+
+  if (!headless) {
+    ::irg::window_loop(window, [&]{
+      timed([&]{
+        progressive.render(march);
+        if (show_cost && progressive.current())
+          overlay.draw(*progressive.current(), cost_attachment, max_steps);
+      }, progressive.resolution());
+
+      // the march itself, without the overlay
+      if (capture && progressive.current()) {
+        auto const& target = *progressive.current();
+        capture->capture(target.id(), target.width, target.height);
+      }
+
+      auto const now = ::std::chrono::steady_clock::now();
+      if (print_timing && now - last_summary >= ::std::chrono::seconds{1}) {
+        timer.print_summary(::std::cout);
+        last_summary = now;
+      }
+    }, update_progressive);
+
+    timer.flush();
+    finish_capture();
+    return 0;
+  }
+
+  ::irg::framebuffer target{initial_width, initial_height, formats};
+  ::irg::image frame;
+
+  // with several fractals each one is rendered to <prefix><name>_<frame>
+  for (::std::size_t f = 0; f < library.size(); ++f) {
+    library.select(f);
+    library.wait(shader);
+    if (library.active() != f)
+      continue;
+
+    auto const name = 
+      library.size() > 1 ? library.name(f) + "_" : ::std::string{};
+    rewind();
+
+    if (capture_target && clips) {
+      ::irg::capture_target clip;
+      ::irg::clip_capture_target(*capture_target, library.name(f), clip);
+      open_capture(clip);
+    }
+
+    for (int i = 0; i < frames; ++i) {
+      target.bind();
+      update();
+      timed([&]{ march(target, nullptr); }, {target.width, target.height});
+
+      char index[16];
+      ::std::snprintf(index, sizeof(index), "%04d", i);
+      if (capture) {
+        capture->capture(target.id(), target.width, target.height);
+      } else {
+        target.read(frame);
+        if (auto path = output_prefix + name + index + ".ppm"; 
+            !::irg::write_ppm(path.c_str(), frame))
+          ::std::cerr << "Error while writing file: ",
+          ::irg::terminate(path.c_str());
+      }
+
+      if (cost_prefix)
+        dump_cost(target, cost_prefix + name + index);
+    }
+
+    if (clips)
+      finish_capture();
+  }
+
+  timer.flush();
+  timer.print_summary(::std::cout);
+  finish_capture();
 }